@@ -0,0 +1,153 @@
+/*
+ * File:   CpuFeatures.cpp
+ */
+
+#include "CpuFeatures.h"
+
+#if LS_TEST_X86_DISPATCH && (defined(__GNUC__) || defined(__clang__))
+    #include <cpuid.h>
+#elif LS_TEST_X86_DISPATCH && defined(_MSC_VER)
+    #include <intrin.h>
+    #include <immintrin.h> // _xgetbv()
+#endif
+
+
+
+/*-----------------------------------------------------------------------------
+ * Private helper functions
+-----------------------------------------------------------------------------*/
+namespace {
+
+/*-------------------------------------
+ * Convert a feature test into a bitmask
+-------------------------------------*/
+inline uint32_t feature_bit(const bool isSupported, const cpu_feature_t feature) noexcept {
+    return isSupported ? (uint32_t)feature : 0u;
+}
+
+/*-------------------------------------
+ * Query the CPU
+-------------------------------------*/
+uint32_t query_cpu_features() noexcept {
+    uint32_t features = 0;
+
+#if LS_TEST_X86_DISPATCH && (defined(__GNUC__) || defined(__clang__))
+    // These builtins also verify the OS saves AVX registers on context
+    // switches.
+    __builtin_cpu_init();
+
+    features |= feature_bit(__builtin_cpu_supports("sse2"), CPU_FEATURE_SSE2);
+    features |= feature_bit(__builtin_cpu_supports("sse3"), CPU_FEATURE_SSE3);
+    features |= feature_bit(__builtin_cpu_supports("ssse3"), CPU_FEATURE_SSSE3);
+    features |= feature_bit(__builtin_cpu_supports("sse4.1"), CPU_FEATURE_SSE4_1);
+    features |= feature_bit(__builtin_cpu_supports("sse4.2"), CPU_FEATURE_SSE4_2);
+    features |= feature_bit(__builtin_cpu_supports("avx"), CPU_FEATURE_AVX);
+    features |= feature_bit(__builtin_cpu_supports("avx2"), CPU_FEATURE_AVX2);
+    features |= feature_bit(__builtin_cpu_supports("fma"), CPU_FEATURE_FMA);
+    features |= feature_bit(__builtin_cpu_supports("avx512f"), CPU_FEATURE_AVX512F);
+
+    // F16C shares its OS requirements with AVX.
+    unsigned eax, ebx, ecx, edx;
+    if ((features & CPU_FEATURE_AVX) && __get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        features |= feature_bit((ecx & bit_F16C) != 0, CPU_FEATURE_F16C);
+    }
+
+#elif LS_TEST_X86_DISPATCH && defined(_MSC_VER)
+    int regs[4];
+
+    __cpuid(regs, 0);
+    const int maxLeaf = regs[0];
+
+    __cpuid(regs, 1);
+    const uint32_t ecx1 = (uint32_t)regs[2];
+    const uint32_t edx1 = (uint32_t)regs[3];
+
+    features |= feature_bit((edx1 & (1u << 26)) != 0, CPU_FEATURE_SSE2);
+    features |= feature_bit((ecx1 & (1u << 0)) != 0, CPU_FEATURE_SSE3);
+    features |= feature_bit((ecx1 & (1u << 9)) != 0, CPU_FEATURE_SSSE3);
+    features |= feature_bit((ecx1 & (1u << 19)) != 0, CPU_FEATURE_SSE4_1);
+    features |= feature_bit((ecx1 & (1u << 20)) != 0, CPU_FEATURE_SSE4_2);
+
+    // AVX state must be enabled by the OS through XSAVE
+    const bool haveOsxsave = (ecx1 & (1u << 27)) != 0;
+    const uint64_t xcr0 = haveOsxsave ? _xgetbv(0) : 0;
+    const bool haveYmm = (xcr0 & 0x06) == 0x06;
+    const bool haveZmm = (xcr0 & 0xE6) == 0xE6;
+
+    if (haveYmm && (ecx1 & (1u << 28))) {
+        features |= CPU_FEATURE_AVX;
+        features |= feature_bit((ecx1 & (1u << 12)) != 0, CPU_FEATURE_FMA);
+        features |= feature_bit((ecx1 & (1u << 29)) != 0, CPU_FEATURE_F16C);
+
+        if (maxLeaf >= 7) {
+            __cpuidex(regs, 7, 0);
+            const uint32_t ebx7 = (uint32_t)regs[1];
+
+            features |= feature_bit((ebx7 & (1u << 5)) != 0, CPU_FEATURE_AVX2);
+            features |= feature_bit(haveZmm && (ebx7 & (1u << 16)) != 0, CPU_FEATURE_AVX512F);
+        }
+    }
+
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(__aarch64__)
+    features |= CPU_FEATURE_NEON;
+#endif
+
+    return features;
+}
+
+} // end anonymous namespace
+
+
+
+/*-----------------------------------------------------------------------------
+ * CPU Feature Queries
+-----------------------------------------------------------------------------*/
+/*-------------------------------------
+ * Retrieve all CPU features
+-------------------------------------*/
+uint32_t get_cpu_features() noexcept {
+    // thread-safe initialization of function-level statics is guaranteed by
+    // C++11
+    static const uint32_t features = query_cpu_features();
+    return features;
+}
+
+/*-------------------------------------
+ * Retrieve the names of all CPU features
+-------------------------------------*/
+std::string get_cpu_feature_names() {
+    struct FeatureName {
+        cpu_feature_t feature;
+        const char* name;
+    };
+
+    constexpr FeatureName featureNames[] = {
+        {CPU_FEATURE_SSE2,    "SSE2"},
+        {CPU_FEATURE_SSE3,    "SSE3"},
+        {CPU_FEATURE_SSSE3,   "SSSE3"},
+        {CPU_FEATURE_SSE4_1,  "SSE4.1"},
+        {CPU_FEATURE_SSE4_2,  "SSE4.2"},
+        {CPU_FEATURE_AVX,     "AVX"},
+        {CPU_FEATURE_AVX2,    "AVX2"},
+        {CPU_FEATURE_FMA,     "FMA"},
+        {CPU_FEATURE_F16C,    "F16C"},
+        {CPU_FEATURE_AVX512F, "AVX-512F"},
+        {CPU_FEATURE_NEON,    "NEON"},
+    };
+
+    std::string names;
+
+    for (const FeatureName& f : featureNames) {
+        if (!has_cpu_feature(f.feature)) {
+            continue;
+        }
+
+        if (!names.empty()) {
+            names += ' ';
+        }
+
+        names += f.name;
+    }
+
+    return names.empty() ? std::string{"none"} : names;
+}
@@ -0,0 +1,82 @@
+/*
+ * File:   CpuFeatures.h
+ */
+
+#ifndef CPUFEATURES_H
+#define CPUFEATURES_H
+
+#include <cstdint>
+#include <string>
+
+
+
+/*-----------------------------------------------------------------------------
+ * Per-function instruction set targets.
+ *
+ * Kernels marked with these macros may use instructions beyond the build's
+ * minimum ISA level (LS_X86_ISA_LEVEL in CMake). They must only be called
+ * after checking has_cpu_feature() for the matching feature.
+-----------------------------------------------------------------------------*/
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #define LS_TEST_X86_DISPATCH 1
+
+    #if defined(__GNUC__) || defined(__clang__)
+        #define LS_TEST_TARGET_AVX2 __attribute__((target("avx2,fma")))
+    #else
+        // MSVC allows all intrinsics regardless of the /arch flag.
+        #define LS_TEST_TARGET_AVX2
+    #endif
+#else
+    #define LS_TEST_X86_DISPATCH 0
+#endif
+
+
+
+/*-----------------------------------------------------------------------------
+ * CPU instruction set extensions which can be queried at runtime.
+-----------------------------------------------------------------------------*/
+enum cpu_feature_t : uint32_t {
+    CPU_FEATURE_SSE2    = 0x00000001,
+    CPU_FEATURE_SSE3    = 0x00000002,
+    CPU_FEATURE_SSSE3   = 0x00000004,
+    CPU_FEATURE_SSE4_1  = 0x00000008,
+    CPU_FEATURE_SSE4_2  = 0x00000010,
+    CPU_FEATURE_AVX     = 0x00000020,
+    CPU_FEATURE_AVX2    = 0x00000040,
+    CPU_FEATURE_FMA     = 0x00000080,
+    CPU_FEATURE_F16C    = 0x00000100,
+    CPU_FEATURE_AVX512F = 0x00000200,
+    CPU_FEATURE_NEON    = 0x00000400,
+};
+
+
+
+/**
+ * @brief Retrieve a bitmask of all cpu_feature_t values supported by the
+ * current CPU and operating system.
+ *
+ * The CPU is only queried on the first call. All later calls return a cached
+ * value and are safe to make from multiple threads.
+ */
+uint32_t get_cpu_features() noexcept;
+
+
+
+/**
+ * @brief Determine if the current CPU supports an instruction set extension.
+ */
+inline bool has_cpu_feature(const cpu_feature_t feature) noexcept {
+    return (get_cpu_features() & feature) == feature;
+}
+
+
+
+/**
+ * @brief Retrieve a space-separated list of the names of all supported CPU
+ * features, for logging.
+ */
+std::string get_cpu_feature_names();
+
+
+
+#endif  /* CPUFEATURES_H */
@@ -0,0 +1,432 @@
+/*
+ * File:   FileWatcher.cpp
+ */
+
+#include <algorithm> // std::find, std::lower_bound, std::sort
+#include <utility> // std::move
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h> // FindFirstFileA(), FindNextFileA()
+#else
+    #include <dirent.h> // opendir(), readdir()
+#endif
+
+#ifdef __linux__
+    #include <cerrno>
+    #include <climits> // NAME_MAX
+    #include <unistd.h> // read(), close()
+    #include <sys/inotify.h>
+#endif
+
+#include "FileWatcher.h"
+
+
+
+/*-----------------------------------------------------------------------------
+ * Private helper functions
+-----------------------------------------------------------------------------*/
+namespace {
+
+/*-------------------------------------
+ * Retrieve the size and modification time of a file
+-------------------------------------*/
+bool get_file_stats(const std::string& path, bool& outIsDir, int64_t& outSize, int64_t& outModTime) noexcept {
+    struct stat fileStats;
+
+    if (stat(path.c_str(), &fileStats) != 0) {
+        return false;
+    }
+
+    outIsDir = (fileStats.st_mode & S_IFMT) == S_IFDIR;
+    outSize = (int64_t)fileStats.st_size;
+
+#ifdef __linux__
+    // Editors can save several times within one second
+    outModTime = (int64_t)fileStats.st_mtim.tv_sec * 1000000000 + (int64_t)fileStats.st_mtim.tv_nsec;
+#else
+    outModTime = (int64_t)fileStats.st_mtime;
+#endif
+
+    return true;
+}
+
+/*-------------------------------------
+ * Retrieve the name of each entry in a directory
+-------------------------------------*/
+void list_directory(const std::string& dirPath, std::vector<std::string>& outNames) {
+    outNames.clear();
+
+#ifdef _WIN32
+    WIN32_FIND_DATAA findData;
+    const HANDLE hFind = FindFirstFileA((dirPath + "\\*").c_str(), &findData);
+
+    if (hFind == INVALID_HANDLE_VALUE) {
+        return;
+    }
+
+    do {
+        outNames.emplace_back(findData.cFileName);
+    } while (FindNextFileA(hFind, &findData));
+
+    FindClose(hFind);
+#else
+    DIR* const pDir = opendir(dirPath.c_str());
+
+    if (!pDir) {
+        return;
+    }
+
+    while (const dirent* const pEntry = readdir(pDir)) {
+        outNames.emplace_back(pEntry->d_name);
+    }
+
+    closedir(pDir);
+#endif
+}
+
+/*-------------------------------------
+ * Append a path only if it hasn't been reported yet
+-------------------------------------*/
+void append_unique_path(std::vector<std::string>& outPaths, const size_t firstNewPath, const std::string& path) {
+    const std::vector<std::string>::iterator&& iter = std::find(outPaths.begin() + firstNewPath, outPaths.end(), path);
+
+    if (iter == outPaths.end()) {
+        outPaths.push_back(path);
+    }
+}
+
+} // end anonymous namespace
+
+
+
+/*-----------------------------------------------------------------------------
+ * File Watcher
+-----------------------------------------------------------------------------*/
+/*-------------------------------------
+ * Destructor
+-------------------------------------*/
+FileWatcher::~FileWatcher() noexcept {
+    terminate();
+}
+
+/*-------------------------------------
+ * Constructor
+-------------------------------------*/
+FileWatcher::FileWatcher() noexcept :
+    notifyFd{-1},
+    pollIntervalMs{250},
+    lastStatPoll{},
+    watches{},
+    eventBuffer{}
+{}
+
+/*-------------------------------------
+ * Move Constructor
+-------------------------------------*/
+FileWatcher::FileWatcher(FileWatcher&& fw) noexcept :
+    notifyFd{fw.notifyFd},
+    pollIntervalMs{fw.pollIntervalMs},
+    lastStatPoll{fw.lastStatPoll},
+    watches{std::move(fw.watches)},
+    eventBuffer{std::move(fw.eventBuffer)}
+{
+    fw.notifyFd = -1;
+}
+
+/*-------------------------------------
+ * Move Operator
+-------------------------------------*/
+FileWatcher& FileWatcher::operator=(FileWatcher&& fw) noexcept {
+    if (this != &fw) {
+        terminate();
+
+        notifyFd = fw.notifyFd;
+        fw.notifyFd = -1;
+
+        pollIntervalMs = fw.pollIntervalMs;
+        lastStatPoll = fw.lastStatPoll;
+
+        watches = std::move(fw.watches);
+        eventBuffer = std::move(fw.eventBuffer);
+    }
+
+    return *this;
+}
+
+/*-------------------------------------
+ * Initialization
+-------------------------------------*/
+bool FileWatcher::init() noexcept {
+    terminate();
+
+#ifdef __linux__
+    notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if (notifyFd < 0) {
+        return false;
+    }
+
+    // Large enough to hold several events with maximum-length file names.
+    eventBuffer.resize(16 * (sizeof(inotify_event) + NAME_MAX + 1));
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+/*-------------------------------------
+ * Termination
+-------------------------------------*/
+void FileWatcher::terminate() noexcept {
+#ifdef __linux__
+    if (notifyFd >= 0) {
+        close(notifyFd);
+    }
+#endif
+
+    notifyFd = -1;
+    watches.clear();
+    eventBuffer.clear();
+}
+
+/*-------------------------------------
+ * Add a path to watch
+-------------------------------------*/
+bool FileWatcher::add_watch(const std::string& path) {
+    WatchEntry entry;
+
+    if (!get_file_stats(path, entry.isDirectory, entry.fileSize, entry.modTime)) {
+        return false;
+    }
+
+    entry.watchId = -1;
+    entry.path = path;
+
+    if (entry.isDirectory) {
+        entry.dirPath = path;
+    }
+    else {
+        const std::string::size_type sep = path.find_last_of("/\\");
+
+        if (sep == std::string::npos) {
+            entry.dirPath = ".";
+            entry.fileName = path;
+        }
+        else {
+            entry.dirPath = path.substr(0, sep);
+            entry.fileName = path.substr(sep + 1);
+        }
+    }
+
+#ifdef __linux__
+    if (notifyFd >= 0) {
+        // Fails when the user's watch limit is reached (ENOSPC) or the
+        // directory can't be read. The entry is polled instead.
+        entry.watchId = inotify_add_watch(notifyFd, entry.dirPath.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    }
+#endif
+
+    if (entry.watchId < 0 && entry.isDirectory) {
+        get_dir_files(entry.dirPath, entry.dirFiles);
+    }
+
+    watches.push_back(std::move(entry));
+
+    return true;
+}
+
+/*-------------------------------------
+ * Remove a watched path
+-------------------------------------*/
+void FileWatcher::remove_watch(const std::string& path) {
+    for (std::vector<WatchEntry>::iterator iter = watches.begin(); iter != watches.end(); ++iter) {
+        if (iter->path != path) {
+            continue;
+        }
+
+        const int watchId = iter->watchId;
+        watches.erase(iter);
+
+#ifdef __linux__
+        // inotify shares one watch descriptor between all files in a directory
+        for (const WatchEntry& entry : watches) {
+            if (entry.watchId == watchId) {
+                return;
+            }
+        }
+
+        if (notifyFd >= 0 && watchId >= 0) {
+            inotify_rm_watch(notifyFd, watchId);
+        }
+#else
+        (void)watchId;
+#endif
+
+        return;
+    }
+}
+
+/*-------------------------------------
+ * Retrieve the stats of each file in a directory
+-------------------------------------*/
+void FileWatcher::get_dir_files(const std::string& dirPath, std::vector<FileStats>& outFiles) {
+    std::vector<std::string> names;
+    list_directory(dirPath, names);
+    std::sort(names.begin(), names.end());
+
+    outFiles.clear();
+    outFiles.reserve(names.size());
+
+    for (std::string& name : names) {
+        FileStats file;
+        bool isDir;
+
+        if (!get_file_stats(dirPath + '/' + name, isDir, file.fileSize, file.modTime) || isDir) {
+            continue;
+        }
+
+        file.fileName = std::move(name);
+        outFiles.push_back(std::move(file));
+    }
+}
+
+/*-------------------------------------
+ * Poll for changes using file stats
+-------------------------------------*/
+void FileWatcher::poll_stat_changes(std::vector<std::string>& outPaths, const size_t firstNewPath) {
+    const std::chrono::steady_clock::time_point&& now = std::chrono::steady_clock::now();
+
+    // Directory scans are too expensive to run every frame
+    if (now - lastStatPoll < std::chrono::milliseconds{pollIntervalMs}) {
+        return;
+    }
+
+    lastStatPoll = now;
+    std::vector<FileStats> dirFiles;
+
+    for (WatchEntry& entry : watches) {
+        bool isDir;
+        int64_t fileSize, modTime;
+
+        if (entry.watchId >= 0) {
+            continue;
+        }
+
+        if (entry.isDirectory) {
+            // A directory's own stats only change when entries are added or
+            // removed, so each file within it is checked instead.
+            get_dir_files(entry.dirPath, dirFiles);
+
+            for (const FileStats& file : dirFiles) {
+                const std::vector<FileStats>::const_iterator&& prev = std::lower_bound(
+                    entry.dirFiles.cbegin(),
+                    entry.dirFiles.cend(),
+                    file,
+                    [](const FileStats& a, const FileStats& b)->bool {
+                        return a.fileName < b.fileName;
+                    }
+                );
+
+                if (prev == entry.dirFiles.cend()
+                || prev->fileName != file.fileName
+                || prev->fileSize != file.fileSize
+                || prev->modTime != file.modTime
+                ) {
+                    append_unique_path(outPaths, firstNewPath, entry.dirPath + '/' + file.fileName);
+                }
+            }
+
+            entry.dirFiles.swap(dirFiles);
+            continue;
+        }
+
+        if (!get_file_stats(entry.path, isDir, fileSize, modTime)) {
+            continue;
+        }
+
+        if (fileSize != entry.fileSize || modTime != entry.modTime) {
+            entry.fileSize = fileSize;
+            entry.modTime = modTime;
+            append_unique_path(outPaths, firstNewPath, entry.path);
+        }
+    }
+}
+
+/*-------------------------------------
+ * Poll for changes using OS notifications
+-------------------------------------*/
+void FileWatcher::poll_notify_changes(std::vector<std::string>& outPaths, const size_t firstNewPath) {
+#ifdef __linux__
+    char* const pBuffer = eventBuffer.data();
+
+    while (true) {
+        const ssize_t numBytes = read(notifyFd, pBuffer, eventBuffer.size());
+
+        if (numBytes <= 0) {
+            // EAGAIN means there are no more pending events
+            break;
+        }
+
+        for (ssize_t i = 0; i < numBytes;) {
+            const inotify_event* const pEvent = reinterpret_cast<const inotify_event*>(pBuffer + i);
+            i += (ssize_t)(sizeof(inotify_event) + pEvent->len);
+
+            // Events were dropped. Report everything to be safe.
+            if (pEvent->mask & IN_Q_OVERFLOW) {
+                for (const WatchEntry& entry : watches) {
+                    append_unique_path(outPaths, firstNewPath, entry.path);
+                }
+                continue;
+            }
+
+            if (!pEvent->len) {
+                continue;
+            }
+
+            const std::string eventName{pEvent->name};
+
+            for (const WatchEntry& entry : watches) {
+                if (entry.watchId != pEvent->wd) {
+                    continue;
+                }
+
+                if (entry.isDirectory) {
+                    append_unique_path(outPaths, firstNewPath, entry.dirPath + '/' + eventName);
+                }
+                else if (entry.fileName == eventName) {
+                    append_unique_path(outPaths, firstNewPath, entry.path);
+                }
+            }
+        }
+    }
+#else
+    (void)outPaths;
+    (void)firstNewPath;
+#endif
+}
+
+/*-------------------------------------
+ * Retrieve all file changes
+-------------------------------------*/
+unsigned FileWatcher::poll(std::vector<std::string>& outPaths) {
+    const size_t numPaths = outPaths.size();
+
+    if (notifyFd >= 0) {
+        poll_notify_changes(outPaths, numPaths);
+    }
+
+    // Watches without OS notifications
+    poll_stat_changes(outPaths, numPaths);
+
+    return (unsigned)(outPaths.size() - numPaths);
+}
@@ -0,0 +1,175 @@
+/*
+ * File:   FileWatcher.h
+ */
+
+#ifndef FILEWATCHER_H
+#define FILEWATCHER_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+
+/**----------------------------------------------------------------------------
+ * Non-blocking file-change notifications for asset hot-reloading.
+ *
+ * On Linux, watches are implemented with inotify. Watching a file places a
+ * watch on its parent directory so editors which save by renaming a temporary
+ * file over the original are still detected. All other platforms, and any
+ * path inotify can't watch, fall back to polling the size and modification
+ * time of each watched file and of every file within each watched directory.
+ * Polling is limited to once per poll interval.
+-----------------------------------------------------------------------------*/
+class FileWatcher {
+  private:
+    struct FileStats {
+        int64_t fileSize;
+
+        int64_t modTime;
+
+        std::string fileName;
+    };
+
+    struct WatchEntry {
+        int watchId;
+
+        bool isDirectory;
+
+        int64_t fileSize;
+
+        int64_t modTime;
+
+        std::string path;
+
+        std::string dirPath;
+
+        std::string fileName;
+
+        // Files within a directory, sorted by name. Only used when polling.
+        std::vector<FileStats> dirFiles;
+    };
+
+    int notifyFd;
+
+    unsigned pollIntervalMs;
+
+    std::chrono::steady_clock::time_point lastStatPoll;
+
+    std::vector<WatchEntry> watches;
+
+    std::vector<char> eventBuffer;
+
+    static void get_dir_files(const std::string& dirPath, std::vector<FileStats>& outFiles);
+
+    void poll_stat_changes(std::vector<std::string>& outPaths, const size_t firstNewPath);
+
+    void poll_notify_changes(std::vector<std::string>& outPaths, const size_t firstNewPath);
+
+  public:
+    ~FileWatcher() noexcept;
+
+    FileWatcher() noexcept;
+
+    FileWatcher(const FileWatcher&) = delete;
+
+    FileWatcher(FileWatcher&&) noexcept;
+
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    FileWatcher& operator=(FileWatcher&&) noexcept;
+
+    /**
+     * @brief Initialize the OS notification handle.
+     *
+     * @return TRUE if notifications can be received, FALSE if not. Watches
+     * added afterwards will be polled instead.
+     */
+    bool init() noexcept;
+
+    /**
+     * @brief Remove all watches and release the OS notification handle.
+     */
+    void terminate() noexcept;
+
+    /**
+     * @brief Watch a file or directory for changes.
+     *
+     * @param path
+     * A path to an existing file or directory. Files written or created
+     * directly within a watched directory are reported. Subdirectories are
+     * not watched.
+     *
+     * @return TRUE if the path is being watched, FALSE if it could not be
+     * found. Paths which can't be watched by the OS are polled instead.
+     */
+    bool add_watch(const std::string& path);
+
+    /**
+     * @brief Stop watching a file or directory.
+     *
+     * @param path
+     * The same path which was passed into add_watch().
+     */
+    void remove_watch(const std::string& path);
+
+    /**
+     * @brief Retrieve all changes since the last call to poll() without
+     * blocking.
+     *
+     * @param outPaths
+     * Each path which was written, created, or moved into place will be
+     * appended to this container. Duplicate paths are reported once.
+     *
+     * @return The number of paths appended to outPaths.
+     */
+    unsigned poll(std::vector<std::string>& outPaths);
+
+    /**
+     * @brief Set the minimum time between polls of watches which have no OS
+     * notifications.
+     *
+     * @param millis
+     * The poll interval, in milliseconds. Zero polls on every call to poll().
+     */
+    void set_poll_interval(const unsigned millis) noexcept;
+
+    /**
+     * @brief Retrieve the minimum time between polls of watches which have no
+     * OS notifications.
+     *
+     * @return The poll interval, in milliseconds.
+     */
+    unsigned get_poll_interval() const noexcept;
+
+    /**
+     * @brief Determine the number of active watches.
+     *
+     * @return The number of paths passed to add_watch() which are still
+     * watched.
+     */
+    unsigned get_num_watches() const noexcept;
+};
+
+
+
+inline void FileWatcher::set_poll_interval(const unsigned millis) noexcept {
+    pollIntervalMs = millis;
+}
+
+
+
+inline unsigned FileWatcher::get_poll_interval() const noexcept {
+    return pollIntervalMs;
+}
+
+
+
+inline unsigned FileWatcher::get_num_watches() const noexcept {
+    return (unsigned)watches.size();
+}
+
+
+
+#endif  /* FILEWATCHER_H */
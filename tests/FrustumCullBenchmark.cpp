@@ -0,0 +1,197 @@
+/*
+ * File:   FrustumCullBenchmark.cpp
+ */
+
+#include <algorithm> // std::max
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <memory> // std::unique_ptr
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "CpuFeatures.h"
+#include "FrustumCulling.h"
+#include "WorkerPool.h"
+
+
+
+/*-----------------------------------------------------------------------------
+ * Benchmark helpers
+-----------------------------------------------------------------------------*/
+namespace {
+
+typedef std::chrono::steady_clock bench_clock_t;
+typedef std::chrono::duration<double, std::milli> bench_millis_t;
+
+/*-------------------------------------
+ * Column-major perspective * look-at matrix, looking down -Z from the origin.
+-------------------------------------*/
+void make_view_projection(float outMatrix[16], const float yaw) {
+    const float fov    = 60.f * 3.14159265f / 180.f;
+    const float aspect = 16.f / 9.f;
+    const float zNear  = 0.1f;
+    const float zFar   = 1000.f;
+    const float f      = 1.f / std::tan(fov * 0.5f);
+
+    const float proj[16] = {
+        f / aspect, 0.f, 0.f, 0.f,
+        0.f, f, 0.f, 0.f,
+        0.f, 0.f, (zFar + zNear) / (zNear - zFar), -1.f,
+        0.f, 0.f, (2.f * zFar * zNear) / (zNear - zFar), 0.f
+    };
+
+    // rotation about the Y axis
+    const float c = std::cos(yaw);
+    const float s = std::sin(yaw);
+    const float view[16] = {
+        c, 0.f, -s, 0.f,
+        0.f, 1.f, 0.f, 0.f,
+        s, 0.f, c, 0.f,
+        0.f, 0.f, 0.f, 1.f
+    };
+
+    for (unsigned col = 0; col < 4; ++col) {
+        for (unsigned row = 0; row < 4; ++row) {
+            float sum = 0.f;
+            for (unsigned k = 0; k < 4; ++k) {
+                sum += proj[k*4 + row] * view[col*4 + k];
+            }
+            outMatrix[col*4 + row] = sum;
+        }
+    }
+}
+
+/*-------------------------------------
+ * Random boxes scattered around the camera
+-------------------------------------*/
+void generate_bounds(CullingBounds& outBounds, const unsigned numBounds) {
+    std::mt19937 rng{1234u};
+    std::uniform_real_distribution<float> posDist{-500.f, 500.f};
+    std::uniform_real_distribution<float> sizeDist{0.1f, 4.f};
+
+    outBounds.clear();
+    outBounds.reserve(numBounds);
+
+    for (unsigned i = 0; i < numBounds; ++i) {
+        const float minPos[3] = {posDist(rng), posDist(rng), posDist(rng)};
+        const float maxPos[3] = {minPos[0] + sizeDist(rng), minPos[1] + sizeDist(rng), minPos[2] + sizeDist(rng)};
+        outBounds.push_back(minPos, maxPos);
+    }
+}
+
+/*-------------------------------------
+ * Time a culling configuration
+-------------------------------------*/
+double time_culling(
+    FrustumCuller& culler,
+    const FrustumPlanes& frustum,
+    const CullingBounds& bounds,
+    std::vector<unsigned>& outVisible,
+    WorkerPool* pWorkers
+) {
+    // warm up caches and threads
+    culler.cull(frustum, bounds, outVisible, pWorkers);
+
+    unsigned numIters = 0;
+    const bench_clock_t::time_point start = bench_clock_t::now();
+    bench_millis_t elapsed{0.0};
+
+    do {
+        culler.cull(frustum, bounds, outVisible, pWorkers);
+        ++numIters;
+        elapsed = bench_clock_t::now() - start;
+    } while (elapsed.count() < 250.0);
+
+    return elapsed.count() / (double)numIters;
+}
+
+const char* get_kernel_name(const cull_kernel_t kernel) {
+    switch (kernel) {
+        case CULL_KERNEL_SCALAR: return "scalar";
+        case CULL_KERNEL_SSE:    return "SSE";
+        case CULL_KERNEL_AVX2:   return "AVX2";
+        case CULL_KERNEL_NEON:   return "NEON";
+        default:                 break;
+    }
+
+    return "unknown";
+}
+
+} // end anonymous namespace
+
+
+
+/*-------------------------------------
+ * main()
+-------------------------------------*/
+int main() {
+    const unsigned boxCounts[] = {1000, 10000, 100000, 1000000};
+    const cull_kernel_t kernels[] = {CULL_KERNEL_SCALAR, CULL_KERNEL_SSE, CULL_KERNEL_AVX2, CULL_KERNEL_NEON};
+    const unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    float vpMatrix[16];
+    make_view_projection(vpMatrix, 0.5f);
+    const FrustumPlanes&& frustum = extract_frustum_planes(vpMatrix);
+
+    // Powers of two up to the hardware limit, then the hardware limit itself
+    std::vector<unsigned> threadCounts;
+    for (unsigned numThreads = 1; numThreads < maxThreads; numThreads *= 2) {
+        threadCounts.push_back(numThreads);
+    }
+    threadCounts.push_back(maxThreads);
+
+    // The calling thread also runs culling tasks, so pools have one less
+    // worker than the thread count they're timed with.
+    std::vector<std::unique_ptr<WorkerPool>> workerPools;
+    for (const unsigned numThreads : threadCounts) {
+        workerPools.emplace_back(numThreads > 1 ? new WorkerPool{numThreads - 1} : nullptr);
+    }
+
+    CullingBounds bounds;
+    std::vector<unsigned> visible, reference;
+    bool allMatched = true;
+
+    std::cout << "CPU Features: " << get_cpu_feature_names() << '\n';
+    std::cout << std::setw(10) << "Boxes"
+              << std::setw(10) << "Kernel"
+              << std::setw(10) << "Threads"
+              << std::setw(12) << "ms/cull"
+              << std::setw(14) << "Mboxes/s"
+              << std::setw(10) << "Visible" << '\n';
+
+    for (const unsigned numBoxes : boxCounts) {
+        generate_bounds(bounds, numBoxes);
+
+        FrustumCuller{CULL_KERNEL_SCALAR}.cull(frustum, bounds, reference);
+
+        for (const cull_kernel_t kernel : kernels) {
+            FrustumCuller culler{kernel};
+
+            // unsupported kernels fall back to one which was already tested
+            if (culler.get_kernel() != kernel) {
+                continue;
+            }
+
+            for (unsigned t = 0; t < (unsigned)threadCounts.size(); ++t) {
+                const unsigned numThreads = threadCounts[t];
+                const double ms = time_culling(culler, frustum, bounds, visible, workerPools[t].get());
+                const bool matched = visible == reference;
+                allMatched = allMatched && matched;
+
+                std::cout << std::setw(10) << numBoxes
+                          << std::setw(10) << get_kernel_name(kernel)
+                          << std::setw(10) << numThreads
+                          << std::setw(12) << std::fixed << std::setprecision(4) << ms
+                          << std::setw(14) << std::setprecision(1) << ((double)numBoxes / ms / 1000.0)
+                          << std::setw(10) << visible.size()
+                          << (matched ? "" : "  MISMATCH") << '\n';
+            }
+        }
+    }
+
+    // Scripted runs fail if any kernel disagrees with the scalar reference
+    return allMatched ? 0 : 1;
+}
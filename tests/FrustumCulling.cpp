@@ -0,0 +1,665 @@
+/*
+ * File:   FrustumCulling.cpp
+ */
+
+#include <algorithm> // std::min
+#include <cmath> // std::sqrt
+#include <cstring> // std::memmove
+#include <functional>
+#include <limits> // std::numeric_limits
+#include <utility> // std::move
+
+#include "CpuFeatures.h"
+#include "WorkerPool.h"
+#include "FrustumCulling.h"
+
+#if LS_TEST_X86_DISPATCH
+    #include <immintrin.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define LS_TEST_CULL_SSE 1
+#else
+    #define LS_TEST_CULL_SSE 0
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define LS_TEST_CULL_NEON 1
+#else
+    #define LS_TEST_CULL_NEON 0
+#endif
+
+
+
+/*-----------------------------------------------------------------------------
+ * Private culling kernels
+-----------------------------------------------------------------------------*/
+namespace {
+
+enum : unsigned {
+    // Minimum number of boxes tested by each thread
+    CULL_MIN_BOXES_PER_TASK = 16384,
+
+    // Number of tasks assigned to each thread, for load balancing
+    CULL_TASKS_PER_THREAD = 4
+};
+
+/*-------------------------------------
+ * Per-plane constants
+ *
+ * Testing only the corner of a box furthest along a plane's normal (the
+ * "positive vertex") is enough to tell if the box is fully outside of that
+ * plane. Selecting the min or max stream for each axis once per plane keeps
+ * the inner loops free of blends.
+-------------------------------------*/
+struct PlaneStreams {
+    const float* pX;
+    const float* pY;
+    const float* pZ;
+    float a, b, c, d;
+};
+
+inline void get_plane_streams(const FrustumPlanes& frustum, const CullingBounds& bounds, PlaneStreams outStreams[6]) noexcept {
+    for (unsigned p = 0; p < 6; ++p) {
+        const float* const plane = frustum.planes[p];
+
+        outStreams[p].pX = bounds.get_stream(plane[0] >= 0.f ? CULL_BOUNDS_MAX_X : CULL_BOUNDS_MIN_X);
+        outStreams[p].pY = bounds.get_stream(plane[1] >= 0.f ? CULL_BOUNDS_MAX_Y : CULL_BOUNDS_MIN_Y);
+        outStreams[p].pZ = bounds.get_stream(plane[2] >= 0.f ? CULL_BOUNDS_MAX_Z : CULL_BOUNDS_MIN_Z);
+        outStreams[p].a = plane[0];
+        outStreams[p].b = plane[1];
+        outStreams[p].c = plane[2];
+        outStreams[p].d = plane[3];
+    }
+}
+
+/*-------------------------------------
+ * Scalar Kernel
+-------------------------------------*/
+unsigned cull_kernel_scalar(const PlaneStreams planes[6], unsigned i, const unsigned end, unsigned* pOut) noexcept {
+    unsigned numVisible = 0;
+
+    for (; i < end; ++i) {
+        bool isVisible = true;
+
+        for (unsigned p = 0; p < 6; ++p) {
+            const PlaneStreams& s = planes[p];
+            isVisible = isVisible && (s.a*s.pX[i] + s.b*s.pY[i] + s.c*s.pZ[i] + s.d) >= 0.f;
+        }
+
+        // branchless compaction
+        pOut[numVisible] = i;
+        numVisible += isVisible ? 1 : 0;
+    }
+
+    return numVisible;
+}
+
+/*-------------------------------------
+ * SSE Kernel (4 boxes per iteration)
+-------------------------------------*/
+#if LS_TEST_CULL_SSE
+unsigned cull_kernel_sse(const PlaneStreams planes[6], unsigned i, const unsigned end, unsigned* pOut) noexcept {
+    unsigned numVisible = 0;
+    const __m128 zero = _mm_setzero_ps();
+
+    for (; i + 4 <= end; i += 4) {
+        __m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+        for (unsigned p = 0; p < 6; ++p) {
+            const PlaneStreams& s = planes[p];
+            __m128 dist = _mm_set1_ps(s.d);
+            dist = _mm_add_ps(dist, _mm_mul_ps(_mm_set1_ps(s.a), _mm_loadu_ps(s.pX + i)));
+            dist = _mm_add_ps(dist, _mm_mul_ps(_mm_set1_ps(s.b), _mm_loadu_ps(s.pY + i)));
+            dist = _mm_add_ps(dist, _mm_mul_ps(_mm_set1_ps(s.c), _mm_loadu_ps(s.pZ + i)));
+            visible = _mm_and_ps(visible, _mm_cmpge_ps(dist, zero));
+        }
+
+        const unsigned mask = (unsigned)_mm_movemask_ps(visible);
+
+        for (unsigned j = 0; j < 4; ++j) {
+            pOut[numVisible] = i + j;
+            numVisible += (mask >> j) & 1u;
+        }
+    }
+
+    return numVisible + cull_kernel_scalar(planes, i, end, pOut + numVisible);
+}
+#endif
+
+/*-------------------------------------
+ * AVX2 Kernel (8 boxes per iteration)
+-------------------------------------*/
+#if LS_TEST_X86_DISPATCH
+LS_TEST_TARGET_AVX2
+unsigned cull_kernel_avx2(const PlaneStreams planes[6], unsigned i, const unsigned end, unsigned* pOut) noexcept {
+    unsigned numVisible = 0;
+    const __m256 zero = _mm256_setzero_ps();
+
+    __m256 a[6], b[6], c[6], d[6];
+    for (unsigned p = 0; p < 6; ++p) {
+        a[p] = _mm256_set1_ps(planes[p].a);
+        b[p] = _mm256_set1_ps(planes[p].b);
+        c[p] = _mm256_set1_ps(planes[p].c);
+        d[p] = _mm256_set1_ps(planes[p].d);
+    }
+
+    for (; i + 8 <= end; i += 8) {
+        __m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+        for (unsigned p = 0; p < 6; ++p) {
+            const PlaneStreams& s = planes[p];
+            __m256 dist = _mm256_fmadd_ps(a[p], _mm256_loadu_ps(s.pX + i), d[p]);
+            dist = _mm256_fmadd_ps(b[p], _mm256_loadu_ps(s.pY + i), dist);
+            dist = _mm256_fmadd_ps(c[p], _mm256_loadu_ps(s.pZ + i), dist);
+            visible = _mm256_and_ps(visible, _mm256_cmp_ps(dist, zero, _CMP_GE_OQ));
+        }
+
+        const unsigned mask = (unsigned)_mm256_movemask_ps(visible);
+
+        for (unsigned j = 0; j < 8; ++j) {
+            pOut[numVisible] = i + j;
+            numVisible += (mask >> j) & 1u;
+        }
+    }
+
+    return numVisible + cull_kernel_scalar(planes, i, end, pOut + numVisible);
+}
+#endif
+
+/*-------------------------------------
+ * NEON Kernel (4 boxes per iteration)
+-------------------------------------*/
+#if LS_TEST_CULL_NEON
+unsigned cull_kernel_neon(const PlaneStreams planes[6], unsigned i, const unsigned end, unsigned* pOut) noexcept {
+    unsigned numVisible = 0;
+    const float32x4_t zero = vdupq_n_f32(0.f);
+
+    for (; i + 4 <= end; i += 4) {
+        uint32x4_t visible = vdupq_n_u32(0xFFFFFFFFu);
+
+        for (unsigned p = 0; p < 6; ++p) {
+            const PlaneStreams& s = planes[p];
+            float32x4_t dist = vdupq_n_f32(s.d);
+            dist = vmlaq_f32(dist, vdupq_n_f32(s.a), vld1q_f32(s.pX + i));
+            dist = vmlaq_f32(dist, vdupq_n_f32(s.b), vld1q_f32(s.pY + i));
+            dist = vmlaq_f32(dist, vdupq_n_f32(s.c), vld1q_f32(s.pZ + i));
+            visible = vandq_u32(visible, vcgeq_f32(dist, zero));
+        }
+
+        pOut[numVisible] = i;
+        numVisible += vgetq_lane_u32(visible, 0) & 1u;
+        pOut[numVisible] = i + 1;
+        numVisible += vgetq_lane_u32(visible, 1) & 1u;
+        pOut[numVisible] = i + 2;
+        numVisible += vgetq_lane_u32(visible, 2) & 1u;
+        pOut[numVisible] = i + 3;
+        numVisible += vgetq_lane_u32(visible, 3) & 1u;
+    }
+
+    return numVisible + cull_kernel_scalar(planes, i, end, pOut + numVisible);
+}
+#endif
+
+/*-------------------------------------
+ * Scalar Distance Kernel
+ *
+ * Distance kernels write the smallest positive-vertex distance of each box,
+ * matching get_box_frustum_distance().
+-------------------------------------*/
+void distance_kernel_scalar(const PlaneStreams planes[6], unsigned i, const unsigned end, float* pOut) noexcept {
+    for (; i < end; ++i) {
+        float minDist = planes[0].a*planes[0].pX[i] + planes[0].b*planes[0].pY[i] + planes[0].c*planes[0].pZ[i] + planes[0].d;
+
+        for (unsigned p = 1; p < 6; ++p) {
+            const PlaneStreams& s = planes[p];
+            minDist = std::min(minDist, s.a*s.pX[i] + s.b*s.pY[i] + s.c*s.pZ[i] + s.d);
+        }
+
+        *pOut++ = minDist;
+    }
+}
+
+/*-------------------------------------
+ * SSE Distance Kernel (4 boxes per iteration)
+-------------------------------------*/
+#if LS_TEST_CULL_SSE
+void distance_kernel_sse(const PlaneStreams planes[6], unsigned i, const unsigned end, float* pOut) noexcept {
+    for (; i + 4 <= end; i += 4, pOut += 4) {
+        __m128 minDist = _mm_set1_ps(std::numeric_limits<float>::max());
+
+        for (unsigned p = 0; p < 6; ++p) {
+            const PlaneStreams& s = planes[p];
+            __m128 dist = _mm_set1_ps(s.d);
+            dist = _mm_add_ps(dist, _mm_mul_ps(_mm_set1_ps(s.a), _mm_loadu_ps(s.pX + i)));
+            dist = _mm_add_ps(dist, _mm_mul_ps(_mm_set1_ps(s.b), _mm_loadu_ps(s.pY + i)));
+            dist = _mm_add_ps(dist, _mm_mul_ps(_mm_set1_ps(s.c), _mm_loadu_ps(s.pZ + i)));
+            minDist = _mm_min_ps(minDist, dist);
+        }
+
+        _mm_storeu_ps(pOut, minDist);
+    }
+
+    distance_kernel_scalar(planes, i, end, pOut);
+}
+#endif
+
+/*-------------------------------------
+ * AVX2 Distance Kernel (8 boxes per iteration)
+-------------------------------------*/
+#if LS_TEST_X86_DISPATCH
+LS_TEST_TARGET_AVX2
+void distance_kernel_avx2(const PlaneStreams planes[6], unsigned i, const unsigned end, float* pOut) noexcept {
+    __m256 a[6], b[6], c[6], d[6];
+    for (unsigned p = 0; p < 6; ++p) {
+        a[p] = _mm256_set1_ps(planes[p].a);
+        b[p] = _mm256_set1_ps(planes[p].b);
+        c[p] = _mm256_set1_ps(planes[p].c);
+        d[p] = _mm256_set1_ps(planes[p].d);
+    }
+
+    for (; i + 8 <= end; i += 8, pOut += 8) {
+        __m256 minDist = _mm256_set1_ps(std::numeric_limits<float>::max());
+
+        for (unsigned p = 0; p < 6; ++p) {
+            const PlaneStreams& s = planes[p];
+            __m256 dist = _mm256_fmadd_ps(a[p], _mm256_loadu_ps(s.pX + i), d[p]);
+            dist = _mm256_fmadd_ps(b[p], _mm256_loadu_ps(s.pY + i), dist);
+            dist = _mm256_fmadd_ps(c[p], _mm256_loadu_ps(s.pZ + i), dist);
+            minDist = _mm256_min_ps(minDist, dist);
+        }
+
+        _mm256_storeu_ps(pOut, minDist);
+    }
+
+    distance_kernel_scalar(planes, i, end, pOut);
+}
+#endif
+
+/*-------------------------------------
+ * NEON Distance Kernel (4 boxes per iteration)
+-------------------------------------*/
+#if LS_TEST_CULL_NEON
+void distance_kernel_neon(const PlaneStreams planes[6], unsigned i, const unsigned end, float* pOut) noexcept {
+    for (; i + 4 <= end; i += 4, pOut += 4) {
+        float32x4_t minDist = vdupq_n_f32(std::numeric_limits<float>::max());
+
+        for (unsigned p = 0; p < 6; ++p) {
+            const PlaneStreams& s = planes[p];
+            float32x4_t dist = vdupq_n_f32(s.d);
+            dist = vmlaq_f32(dist, vdupq_n_f32(s.a), vld1q_f32(s.pX + i));
+            dist = vmlaq_f32(dist, vdupq_n_f32(s.b), vld1q_f32(s.pY + i));
+            dist = vmlaq_f32(dist, vdupq_n_f32(s.c), vld1q_f32(s.pZ + i));
+            minDist = vminq_f32(minDist, dist);
+        }
+
+        vst1q_f32(pOut, minDist);
+    }
+
+    distance_kernel_scalar(planes, i, end, pOut);
+}
+#endif
+
+/*-------------------------------------
+ * Split a number of boxes into tasks
+ *
+ * Each task's range is a multiple of the widest SIMD width.
+-------------------------------------*/
+unsigned get_boxes_per_task(const unsigned numBounds, const WorkerPool* pWorkers) noexcept {
+    const unsigned concurrency = pWorkers ? pWorkers->get_concurrency() : 1u;
+    const unsigned maxTasks = concurrency * CULL_TASKS_PER_THREAD;
+    unsigned boxesPerTask = (numBounds + maxTasks - 1) / maxTasks;
+
+    boxesPerTask = std::max<unsigned>(boxesPerTask, CULL_MIN_BOXES_PER_TASK);
+    return (boxesPerTask + 7u) & ~7u;
+}
+
+/*-------------------------------------
+ * Kernel selection
+-------------------------------------*/
+cull_kernel_t get_supported_kernel(const cull_kernel_t requested) noexcept {
+    switch (requested) {
+        case CULL_KERNEL_AVX2:
+        case CULL_KERNEL_BEST:
+            #if LS_TEST_X86_DISPATCH
+                if (has_cpu_feature(CPU_FEATURE_AVX2) && has_cpu_feature(CPU_FEATURE_FMA)) {
+                    return CULL_KERNEL_AVX2;
+                }
+            #endif
+            // fall through
+
+        case CULL_KERNEL_SSE:
+        case CULL_KERNEL_NEON:
+            #if LS_TEST_CULL_SSE
+                return CULL_KERNEL_SSE;
+            #elif LS_TEST_CULL_NEON
+                return CULL_KERNEL_NEON;
+            #endif
+            // fall through
+
+        default:
+            break;
+    }
+
+    return CULL_KERNEL_SCALAR;
+}
+
+} // end anonymous namespace
+
+
+
+/*-----------------------------------------------------------------------------
+ * Culling Bounds
+-----------------------------------------------------------------------------*/
+/*-------------------------------------
+ * Clear all bounds
+-------------------------------------*/
+void CullingBounds::clear() noexcept {
+    for (std::vector<float>& s : streams) {
+        s.clear();
+    }
+}
+
+/*-------------------------------------
+ * Pre-allocate bounds
+-------------------------------------*/
+void CullingBounds::reserve(const unsigned numBounds) {
+    for (std::vector<float>& s : streams) {
+        s.reserve(numBounds);
+    }
+}
+
+/*-------------------------------------
+ * Add a bounding box
+-------------------------------------*/
+void CullingBounds::push_back(const float* pMin, const float* pMax) {
+    streams[CULL_BOUNDS_MIN_X].push_back(pMin[0]);
+    streams[CULL_BOUNDS_MIN_Y].push_back(pMin[1]);
+    streams[CULL_BOUNDS_MIN_Z].push_back(pMin[2]);
+    streams[CULL_BOUNDS_MAX_X].push_back(pMax[0]);
+    streams[CULL_BOUNDS_MAX_Y].push_back(pMax[1]);
+    streams[CULL_BOUNDS_MAX_Z].push_back(pMax[2]);
+}
+
+/*-------------------------------------
+ * Modify a bounding box
+-------------------------------------*/
+void CullingBounds::set_bounds(const unsigned index, const float* pMin, const float* pMax) noexcept {
+    streams[CULL_BOUNDS_MIN_X][index] = pMin[0];
+    streams[CULL_BOUNDS_MIN_Y][index] = pMin[1];
+    streams[CULL_BOUNDS_MIN_Z][index] = pMin[2];
+    streams[CULL_BOUNDS_MAX_X][index] = pMax[0];
+    streams[CULL_BOUNDS_MAX_Y][index] = pMax[1];
+    streams[CULL_BOUNDS_MAX_Z][index] = pMax[2];
+}
+
+/*-------------------------------------
+ * Retrieve a bounding box
+-------------------------------------*/
+void CullingBounds::get_bounds(const unsigned index, float* pOutMin, float* pOutMax) const noexcept {
+    pOutMin[0] = streams[CULL_BOUNDS_MIN_X][index];
+    pOutMin[1] = streams[CULL_BOUNDS_MIN_Y][index];
+    pOutMin[2] = streams[CULL_BOUNDS_MIN_Z][index];
+    pOutMax[0] = streams[CULL_BOUNDS_MAX_X][index];
+    pOutMax[1] = streams[CULL_BOUNDS_MAX_Y][index];
+    pOutMax[2] = streams[CULL_BOUNDS_MAX_Z][index];
+}
+
+
+
+/*-----------------------------------------------------------------------------
+ * Frustum Planes
+-----------------------------------------------------------------------------*/
+/*-------------------------------------
+ * Plane extraction (Gribb/Hartmann)
+-------------------------------------*/
+FrustumPlanes extract_frustum_planes(const float* pVpMatrix, const float fovScale) noexcept {
+    // Rows of a column-major matrix
+    const float* const m = pVpMatrix;
+    const float row0[4] = {m[0], m[4], m[8],  m[12]};
+    const float row1[4] = {m[1], m[5], m[9],  m[13]};
+    const float row2[4] = {m[2], m[6], m[10], m[14]};
+    const float row3[4] = {m[3], m[7], m[11], m[15]};
+
+    FrustumPlanes frustum;
+
+    for (unsigned i = 0; i < 4; ++i) {
+        frustum.planes[0][i] = fovScale*row3[i] + row0[i]; // left
+        frustum.planes[1][i] = fovScale*row3[i] - row0[i]; // right
+        frustum.planes[2][i] = fovScale*row3[i] + row1[i]; // bottom
+        frustum.planes[3][i] = fovScale*row3[i] - row1[i]; // top
+        frustum.planes[4][i] = row3[i] + row2[i];          // near
+        frustum.planes[5][i] = row3[i] - row2[i];          // far
+    }
+
+    for (float* const plane : frustum.planes) {
+        const float len = std::sqrt(plane[0]*plane[0] + plane[1]*plane[1] + plane[2]*plane[2]);
+        const float invLen = len > 0.f ? 1.f / len : 0.f;
+
+        plane[0] *= invLen;
+        plane[1] *= invLen;
+        plane[2] *= invLen;
+        plane[3] *= invLen;
+    }
+
+    return frustum;
+}
+
+/*-------------------------------------
+ * Single bounding box test
+-------------------------------------*/
+float get_box_frustum_distance(const FrustumPlanes& frustum, const float* pMin, const float* pMax) noexcept {
+    float minDist = 0.f;
+
+    for (unsigned p = 0; p < 6; ++p) {
+        const float* const plane = frustum.planes[p];
+        const float x = plane[0] >= 0.f ? pMax[0] : pMin[0];
+        const float y = plane[1] >= 0.f ? pMax[1] : pMin[1];
+        const float z = plane[2] >= 0.f ? pMax[2] : pMin[2];
+        const float dist = plane[0]*x + plane[1]*y + plane[2]*z + plane[3];
+
+        minDist = p ? std::min(minDist, dist) : dist;
+    }
+
+    return minDist;
+}
+
+
+
+/*-----------------------------------------------------------------------------
+ * Frustum Culler
+-----------------------------------------------------------------------------*/
+/*-------------------------------------
+ * Destructor
+-------------------------------------*/
+FrustumCuller::~FrustumCuller() noexcept {
+}
+
+/*-------------------------------------
+ * Constructor
+-------------------------------------*/
+FrustumCuller::FrustumCuller(const cull_kernel_t cullKernel) noexcept :
+    kernel{get_supported_kernel(cullKernel)},
+    taskCounts{}
+{}
+
+/*-------------------------------------
+ * Move Constructor
+-------------------------------------*/
+FrustumCuller::FrustumCuller(FrustumCuller&& fc) noexcept :
+    kernel{fc.kernel},
+    taskCounts{std::move(fc.taskCounts)}
+{}
+
+/*-------------------------------------
+ * Move Operator
+-------------------------------------*/
+FrustumCuller& FrustumCuller::operator=(FrustumCuller&& fc) noexcept {
+    kernel = fc.kernel;
+    taskCounts = std::move(fc.taskCounts);
+
+    return *this;
+}
+
+/*-------------------------------------
+ * Kernel selection
+-------------------------------------*/
+void FrustumCuller::set_kernel(const cull_kernel_t cullKernel) noexcept {
+    kernel = get_supported_kernel(cullKernel);
+}
+
+/*-------------------------------------
+ * Cull a range of boxes on the current thread
+-------------------------------------*/
+unsigned FrustumCuller::cull_range(
+    const FrustumPlanes& frustum,
+    const CullingBounds& bounds,
+    const unsigned begin,
+    const unsigned end,
+    unsigned* pOutIndices
+) const noexcept {
+    PlaneStreams planes[6];
+    get_plane_streams(frustum, bounds, planes);
+
+    switch (kernel) {
+        #if LS_TEST_X86_DISPATCH
+        case CULL_KERNEL_AVX2:
+            return cull_kernel_avx2(planes, begin, end, pOutIndices);
+        #endif
+
+        #if LS_TEST_CULL_SSE
+        case CULL_KERNEL_SSE:
+            return cull_kernel_sse(planes, begin, end, pOutIndices);
+        #endif
+
+        #if LS_TEST_CULL_NEON
+        case CULL_KERNEL_NEON:
+            return cull_kernel_neon(planes, begin, end, pOutIndices);
+        #endif
+
+        default:
+            break;
+    }
+
+    return cull_kernel_scalar(planes, begin, end, pOutIndices);
+}
+
+/*-------------------------------------
+ * Cull all boxes
+-------------------------------------*/
+unsigned FrustumCuller::cull(
+    const FrustumPlanes& frustum,
+    const CullingBounds& bounds,
+    std::vector<unsigned>& outVisible,
+    WorkerPool* pWorkers
+) {
+    const unsigned numBounds = bounds.size();
+
+    // Every box might be visible. Each task compacts its results into its own
+    // region of the output array, which is then packed together.
+    outVisible.resize(numBounds);
+
+    const unsigned boxesPerTask = get_boxes_per_task(numBounds, pWorkers);
+    const unsigned numTasks = (numBounds + boxesPerTask - 1) / boxesPerTask;
+
+    // Small scenes are culled on the calling thread without waking the pool.
+    if (!pWorkers || numTasks <= 1) {
+        const unsigned numVisible = cull_range(frustum, bounds, 0, numBounds, outVisible.data());
+        outVisible.resize(numVisible);
+        return numVisible;
+    }
+
+    taskCounts.resize(numTasks);
+    unsigned* const pTaskCounts = taskCounts.data();
+    unsigned* const pIndices = outVisible.data();
+
+    const std::function<void(unsigned)> cullTask = [&](unsigned taskId)->void {
+        const unsigned begin = taskId * boxesPerTask;
+        const unsigned end = std::min(begin + boxesPerTask, numBounds);
+        pTaskCounts[taskId] = cull_range(frustum, bounds, begin, end, pIndices + begin);
+    };
+
+    pWorkers->run(numTasks, cullTask);
+
+    unsigned numVisible = pTaskCounts[0];
+
+    for (unsigned t = 1; t < numTasks; ++t) {
+        std::memmove(pIndices + numVisible, pIndices + t * boxesPerTask, sizeof(unsigned) * pTaskCounts[t]);
+        numVisible += pTaskCounts[t];
+    }
+
+    outVisible.resize(numVisible);
+
+    return numVisible;
+}
+
+/*-------------------------------------
+ * Box distances for a range of boxes on the current thread
+-------------------------------------*/
+void FrustumCuller::get_distances_range(
+    const FrustumPlanes& frustum,
+    const CullingBounds& bounds,
+    const unsigned begin,
+    const unsigned end,
+    float* pOutDistances
+) const noexcept {
+    PlaneStreams planes[6];
+    get_plane_streams(frustum, bounds, planes);
+
+    switch (kernel) {
+        #if LS_TEST_X86_DISPATCH
+        case CULL_KERNEL_AVX2:
+            distance_kernel_avx2(planes, begin, end, pOutDistances);
+            return;
+        #endif
+
+        #if LS_TEST_CULL_SSE
+        case CULL_KERNEL_SSE:
+            distance_kernel_sse(planes, begin, end, pOutDistances);
+            return;
+        #endif
+
+        #if LS_TEST_CULL_NEON
+        case CULL_KERNEL_NEON:
+            distance_kernel_neon(planes, begin, end, pOutDistances);
+            return;
+        #endif
+
+        default:
+            break;
+    }
+
+    distance_kernel_scalar(planes, begin, end, pOutDistances);
+}
+
+/*-------------------------------------
+ * Box distances for all boxes
+-------------------------------------*/
+void FrustumCuller::get_distances(
+    const FrustumPlanes& frustum,
+    const CullingBounds& bounds,
+    std::vector<float>& outDistances,
+    WorkerPool* pWorkers
+) const {
+    const unsigned numBounds = bounds.size();
+    const unsigned boxesPerTask = get_boxes_per_task(numBounds, pWorkers);
+    const unsigned numTasks = (numBounds + boxesPerTask - 1) / boxesPerTask;
+
+    outDistances.resize(numBounds);
+    float* const pDistances = outDistances.data();
+
+    if (!pWorkers || numTasks <= 1) {
+        get_distances_range(frustum, bounds, 0, numBounds, pDistances);
+        return;
+    }
+
+    // Tasks write to disjoint ranges, so no compaction is needed afterwards
+    const std::function<void(unsigned)> distanceTask = [&](unsigned taskId)->void {
+        const unsigned begin = taskId * boxesPerTask;
+        const unsigned end = std::min(begin + boxesPerTask, numBounds);
+        get_distances_range(frustum, bounds, begin, end, pDistances + begin);
+    };
+
+    pWorkers->run(numTasks, distanceTask);
+}
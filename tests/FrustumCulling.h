@@ -0,0 +1,276 @@
+/*
+ * File:   FrustumCulling.h
+ */
+
+#ifndef FRUSTUMCULLING_H
+#define FRUSTUMCULLING_H
+
+#include <vector>
+
+
+
+class WorkerPool;
+
+
+
+/*-----------------------------------------------------------------------------
+ * Culling Enumerations
+-----------------------------------------------------------------------------*/
+/**
+ * @brief Individual streams of bounding box data.
+ */
+enum cull_bounds_stream_t : unsigned {
+    CULL_BOUNDS_MIN_X,
+    CULL_BOUNDS_MIN_Y,
+    CULL_BOUNDS_MIN_Z,
+    CULL_BOUNDS_MAX_X,
+    CULL_BOUNDS_MAX_Y,
+    CULL_BOUNDS_MAX_Z,
+
+    CULL_BOUNDS_NUM_STREAMS
+};
+
+
+
+/**
+ * @brief Instruction sets available for testing bounding boxes.
+ *
+ * CULL_KERNEL_BEST is resolved at runtime to the widest kernel supported by
+ * the current CPU.
+ */
+enum cull_kernel_t : unsigned {
+    CULL_KERNEL_SCALAR,
+    CULL_KERNEL_SSE,
+    CULL_KERNEL_AVX2,
+    CULL_KERNEL_NEON,
+
+    CULL_KERNEL_BEST
+};
+
+
+
+/**----------------------------------------------------------------------------
+ * Axis-aligned bounding boxes, stored as one array per component so SIMD
+ * kernels can test several boxes per instruction.
+-----------------------------------------------------------------------------*/
+class CullingBounds {
+  private:
+    std::vector<float> streams[CULL_BOUNDS_NUM_STREAMS];
+
+  public:
+    /**
+     * @brief Remove all bounding boxes.
+     */
+    void clear() noexcept;
+
+    /**
+     * @brief Allocate space for a number of bounding boxes.
+     */
+    void reserve(const unsigned numBounds);
+
+    /**
+     * @brief Retrieve the number of bounding boxes.
+     */
+    unsigned size() const noexcept;
+
+    /**
+     * @brief Append a bounding box.
+     *
+     * @param pMin
+     * An array of 3 floats, containing the minimum XYZ extent of a box.
+     *
+     * @param pMax
+     * An array of 3 floats, containing the maximum XYZ extent of a box.
+     */
+    void push_back(const float* pMin, const float* pMax);
+
+    /**
+     * @brief Replace the extents of an existing bounding box.
+     */
+    void set_bounds(const unsigned index, const float* pMin, const float* pMax) noexcept;
+
+    /**
+     * @brief Retrieve the extents of a bounding box.
+     */
+    void get_bounds(const unsigned index, float* pOutMin, float* pOutMax) const noexcept;
+
+    /**
+     * @brief Retrieve all data for a single component of every bounding box.
+     */
+    const float* get_stream(const cull_bounds_stream_t stream) const noexcept;
+};
+
+
+
+inline unsigned CullingBounds::size() const noexcept {
+    return (unsigned)streams[CULL_BOUNDS_MIN_X].size();
+}
+
+
+
+inline const float* CullingBounds::get_stream(const cull_bounds_stream_t stream) const noexcept {
+    return streams[stream].data();
+}
+
+
+
+/**----------------------------------------------------------------------------
+ * Normalized frustum planes. A point is inside a plane if
+ * dot(plane.xyz, point) + plane.w >= 0.
+ *
+ * Planes are ordered left, right, bottom, top, near, far.
+-----------------------------------------------------------------------------*/
+struct FrustumPlanes {
+    float planes[6][4];
+};
+
+
+
+/**
+ * @brief Extract the frustum planes of a view-projection matrix.
+ *
+ * @param pVpMatrix
+ * 16 floats containing a column-major view-projection matrix with an OpenGL
+ * clip space (-w <= z <= w).
+ *
+ * @param fovScale
+ * Values greater than 1 widen the horizontal and vertical planes so objects
+ * at the edges of the screen do not pop in and out.
+ */
+FrustumPlanes extract_frustum_planes(const float* pVpMatrix, const float fovScale = 1.f) noexcept;
+
+
+
+/**
+ * @brief Test a single bounding box against a frustum.
+ *
+ * @return The smallest signed distance from the box's furthest-inside corner
+ * to any frustum plane. Negative values indicate the box is outside of the
+ * frustum.
+ */
+float get_box_frustum_distance(const FrustumPlanes& frustum, const float* pMin, const float* pMax) noexcept;
+
+
+
+/**
+ * @brief Determine if a bounding box intersects a frustum.
+ */
+inline bool is_box_visible(const FrustumPlanes& frustum, const float* pMin, const float* pMax) noexcept {
+    return get_box_frustum_distance(frustum, pMin, pMax) >= 0.f;
+}
+
+
+
+/**----------------------------------------------------------------------------
+ * Batch frustum culling of bounding box arrays.
+-----------------------------------------------------------------------------*/
+class FrustumCuller {
+  private:
+    cull_kernel_t kernel;
+
+    std::vector<unsigned> taskCounts;
+
+  public:
+    ~FrustumCuller() noexcept;
+
+    FrustumCuller(const cull_kernel_t cullKernel = CULL_KERNEL_BEST) noexcept;
+
+    FrustumCuller(const FrustumCuller&) = default;
+
+    FrustumCuller(FrustumCuller&&) noexcept;
+
+    FrustumCuller& operator=(const FrustumCuller&) = default;
+
+    FrustumCuller& operator=(FrustumCuller&&) noexcept;
+
+    /**
+     * @brief Select the instruction set used for culling.
+     *
+     * Kernels which aren't supported by the current CPU fall back to the
+     * widest supported kernel.
+     */
+    void set_kernel(const cull_kernel_t cullKernel) noexcept;
+
+    /**
+     * @brief Retrieve the instruction set used for culling.
+     */
+    cull_kernel_t get_kernel() const noexcept;
+
+    /**
+     * @brief Test a range of bounding boxes on the calling thread.
+     *
+     * @param pOutIndices
+     * Must have space for (end - begin) indices. The index of each visible
+     * box is written here in ascending order.
+     *
+     * @return The number of visible boxes.
+     */
+    unsigned cull_range(
+        const FrustumPlanes& frustum,
+        const CullingBounds& bounds,
+        const unsigned begin,
+        const unsigned end,
+        unsigned* pOutIndices
+    ) const noexcept;
+
+    /**
+     * @brief Test all bounding boxes against a frustum.
+     *
+     * @param outVisible
+     * Replaced with the index of every visible box, in ascending order.
+     *
+     * @param pWorkers
+     * If not NULL, large arrays of bounds are split across these threads.
+     *
+     * @return The number of visible boxes.
+     */
+    unsigned cull(
+        const FrustumPlanes& frustum,
+        const CullingBounds& bounds,
+        std::vector<unsigned>& outVisible,
+        WorkerPool* pWorkers = nullptr
+    );
+
+    /**
+     * @brief Calculate the distance of a range of boxes to a frustum on the
+     * calling thread.
+     *
+     * @param pOutDistances
+     * Must have space for (end - begin) floats. Receives the same values as
+     * get_box_frustum_distance() for each box, up to rounding.
+     */
+    void get_distances_range(
+        const FrustumPlanes& frustum,
+        const CullingBounds& bounds,
+        const unsigned begin,
+        const unsigned end,
+        float* pOutDistances
+    ) const noexcept;
+
+    /**
+     * @brief Calculate the distance of every box to a frustum.
+     *
+     * @param outDistances
+     * Replaced with one distance per box. Negative values are outside of the
+     * frustum.
+     *
+     * @param pWorkers
+     * If not NULL, large arrays of bounds are split across these threads.
+     */
+    void get_distances(
+        const FrustumPlanes& frustum,
+        const CullingBounds& bounds,
+        std::vector<float>& outDistances,
+        WorkerPool* pWorkers = nullptr
+    ) const;
+};
+
+
+
+inline cull_kernel_t FrustumCuller::get_kernel() const noexcept {
+    return kernel;
+}
+
+
+
+#endif  /* FRUSTUMCULLING_H */
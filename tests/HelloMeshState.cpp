@@ -9,6 +9,7 @@
 #include <cassert>
 #include <ctime>
 #include <algorithm>
+#include <cctype> // std::tolower
 #include <string>
 
 #include <SDL2/SDL.h>
@@ -533,6 +534,48 @@ void main() {
 
 
 
+/*-------------------------------------
+ * Determine if a changed file in the scene's directory affects the scene.
+ * Editor swap, backup, and temporary files are ignored.
+-------------------------------------*/
+bool is_scene_asset(const std::string& path) {
+    const std::string scenePath{LS_GAME_TEST_MESH};
+    const std::string::size_type sceneSep = scenePath.find_last_of("/\\");
+    const std::string::size_type fileSep = path.find_last_of("/\\");
+    const std::string&& sceneName = scenePath.substr(sceneSep == std::string::npos ? 0 : sceneSep + 1);
+    const std::string&& fileName = path.substr(fileSep == std::string::npos ? 0 : fileSep + 1);
+
+    if (fileName == sceneName) {
+        return true;
+    }
+
+    const std::string::size_type extPos = fileName.find_last_of('.');
+
+    // Hidden files (".scene.obj.swp") and files without an extension
+    if (extPos == std::string::npos || extPos == 0) {
+        return false;
+    }
+
+    std::string ext = fileName.substr(extPos + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](const char c)->char {
+        return (char)std::tolower((unsigned char)c);
+    });
+
+    constexpr const char* assetExts[] = {
+        "mtl", "png", "jpg", "jpeg", "tga", "bmp", "gif", "tif", "tiff", "dds", "hdr", "psd"
+    };
+
+    for (const char* const assetExt : assetExts) {
+        if (ext == assetExt) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+
 } // end anonymous namespace
 
 
@@ -549,7 +592,12 @@ HelloMeshState::~HelloMeshState() {
 /*-------------------------------------
  * Constructor
 -------------------------------------*/
-HelloMeshState::HelloMeshState() {
+HelloMeshState::HelloMeshState() :
+    GameState{},
+    sceneReloadPending{false},
+    sceneTransformsDirty{false},
+    numNodesUpdated{0}
+{
 }
 
 /*-------------------------------------
@@ -585,6 +633,19 @@ HelloMeshState& HelloMeshState::operator =(HelloMeshState&& state) {
     enbtShaderUboIndex = state.enbtShaderUboIndex;
     state.enbtShaderUboIndex = 0;
 
+    preloader = std::move(state.preloader);
+
+    sceneWatcher = std::move(state.sceneWatcher);
+
+    sceneReloadPending = state.sceneReloadPending;
+    state.sceneReloadPending = false;
+
+    sceneTransformsDirty = state.sceneTransformsDirty;
+    state.sceneTransformsDirty = false;
+
+    numNodesUpdated = state.numNodesUpdated;
+    state.numNodesUpdated = 0;
+
     return *this;
 }
 
@@ -887,9 +948,9 @@ void HelloMeshState::render_scene_graph(const draw::ShaderProgram& s, const unsi
 /*-------------------------------------
  * Animation updating
 -------------------------------------*/
-void HelloMeshState::update_animations() {
+bool HelloMeshState::update_animations() {
     if (testData.animations.empty()) {
-        return;
+        return false;
     }
 
     const scene_clock_t::time_point&& currTime = scene_clock_t::now();
@@ -911,6 +972,66 @@ void HelloMeshState::update_animations() {
     }
 
     currentAnimation.tick(testData, currentAnimationId, tickTime.count());
+
+    return true;
+}
+
+/*-------------------------------------
+ * Scene graph transformation updates
+-------------------------------------*/
+void HelloMeshState::update_scene_transforms(const bool animationsTicked) {
+    unsigned nodesUpdated = 0;
+
+    // Static scenes only need their transforms updated once after loading.
+    if (animationsTicked || sceneTransformsDirty) {
+        testData.update();
+        nodesUpdated = (unsigned)testData.nodes.size();
+        sceneTransformsDirty = false;
+    }
+
+    if (nodesUpdated != numNodesUpdated) {
+        LS_LOG_MSG("Scene nodes updated per frame: ", nodesUpdated);
+        numNodesUpdated = nodesUpdated;
+    }
+}
+
+/*-------------------------------------
+ * Asynchronous scene loading
+-------------------------------------*/
+void HelloMeshState::preload_scene() {
+    preloader = std::async(std::launch::async, []()->std::pair<bool, draw::SceneFilePreLoader> {
+        std::pair<bool, draw::SceneFilePreLoader> result;
+        result.first = result.second.load(LS_GAME_TEST_MESH);
+
+        if (!result.first) {
+            LS_LOG_ERR("Unable to load ", LS_GAME_TEST_MESH, '.');
+        }
+
+        return result;
+    });
+}
+
+/*-------------------------------------
+ * Scene hot-reloading
+-------------------------------------*/
+void HelloMeshState::check_scene_changes() {
+    std::vector<std::string> changedFiles;
+
+    if (sceneWatcher.poll(changedFiles)) {
+        for (const std::string& file : changedFiles) {
+            if (is_scene_asset(file)) {
+                LS_LOG_MSG("Scene file modified: ", file);
+                sceneReloadPending = true;
+            }
+        }
+    }
+
+    // Changes made during a reload are picked up once it finishes.
+    if (sceneReloadPending && !preloader.valid()) {
+        LS_LOG_MSG("Reloading ", LS_GAME_TEST_MESH);
+        sceneReloadPending = false;
+        preload_scene();
+    }
 }
 
 /*-------------------------------------
@@ -926,11 +1047,25 @@ bool HelloMeshState::on_start() {
 
     setup_uniform_blocks();
 
-    preloader = std::async(std::launch::async, [&]()->draw::SceneFilePreLoader {
-        draw::SceneFilePreLoader loader;
-        loader.load(LS_GAME_TEST_MESH);
-        return loader;
-    });
+    preload_scene();
+
+    // Watch the scene's directory so edits to its textures also trigger a
+    // reload.
+    {
+        const std::string scenePath{LS_GAME_TEST_MESH};
+        const std::string::size_type sep = scenePath.find_last_of("/\\");
+        const std::string&& sceneDir = (sep != std::string::npos) ? scenePath.substr(0, sep) : std::string{"."};
+
+        if (!sceneWatcher.init()) {
+            LS_LOG_MSG("File notifications are unavailable. Polling ", sceneDir, " for changes instead.");
+        }
+
+        if (!sceneWatcher.add_watch(sceneDir)) {
+            LS_LOG_ERR("Unable to watch ", sceneDir, " for changes.");
+        }
+
+        sceneReloadPending = false;
+    }
 
     //utils::Pointer<draw::SceneFileLoader> meshLoader {new draw::SceneFileLoader{}};
 
@@ -949,17 +1084,34 @@ bool HelloMeshState::on_start() {
  * System Runtime
 -------------------------------------*/
 void HelloMeshState::on_run() {
+    check_scene_changes();
+
     // this statement cannot be called from another function (GCC/CLang bug)
     if (preloader.valid() && preloader.wait_for(std::chrono::milliseconds{0}) == std::future_status::ready) {
+        std::pair<bool, draw::SceneFilePreLoader>&& preloadResult = preloader.get();
         draw::SceneFileLoader loader;
-        loader.load(preloader.get());
 
-        testData = std::move(loader.get_loaded_data());
-        setup_animations();
+        // A failed load must not replace the current scene
+        if (!preloadResult.first) {
+            LS_LOG_ERR("Keeping the current scene.");
+        }
+        else if (loader.load(std::move(preloadResult.second))) {
+            // Release the previous scene's GPU data when hot-reloading
+            testData.terminate();
+            testData = std::move(loader.get_loaded_data());
+
+            currentAnimation.reset();
+            setup_animations();
+
+            sceneTransformsDirty = true;
+        }
+        else {
+            LS_LOG_ERR("Unable to upload ", LS_GAME_TEST_MESH, ". Keeping the current scene.");
+        }
     }
     else {
-        update_animations();
-        testData.update();
+        const bool animationsTicked = update_animations();
+        update_scene_transforms(animationsTicked);
     }
 
     uniformBlock.bind();
@@ -1004,4 +1156,8 @@ void HelloMeshState::on_stop() {
     currentAnimationId = 0;
     currentAnimation.reset();
     uniformBlock.terminate();
+    sceneWatcher.terminate();
+    sceneReloadPending = false;
+    sceneTransformsDirty = false;
+    numNodesUpdated = 0;
 }
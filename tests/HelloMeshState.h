@@ -11,6 +11,7 @@
 #include <chrono>
 #include <vector>
 #include <future>
+#include <utility> // std::pair
 
 #include "lightsky/draw/AnimationPlayer.h"
 #include "lightsky/draw/SceneGraph.h"
@@ -20,6 +21,8 @@
 
 #include "lightsky/game/GameState.h"
 
+#include "FileWatcher.h"
+
 
 
 struct Light
@@ -86,7 +89,16 @@ class HelloMeshState final : public ls::game::GameState {
     
     unsigned enbtShaderUboIndex;
 
-    std::future<ls::draw::SceneFilePreLoader> preloader;
+    // The preloaded scene, and whether it loaded successfully
+    std::future<std::pair<bool, ls::draw::SceneFilePreLoader>> preloader;
+    
+    FileWatcher sceneWatcher;
+    
+    bool sceneReloadPending;
+    
+    bool sceneTransformsDirty;
+    
+    unsigned numNodesUpdated;
     
   public:
     virtual ~HelloMeshState();
@@ -121,7 +133,13 @@ class HelloMeshState final : public ls::game::GameState {
     
     void render_scene_graph(const ls::draw::ShaderProgram& s, const unsigned uboBindIndex);
     
-    void update_animations();
+    bool update_animations();
+    
+    void update_scene_transforms(const bool animationsTicked);
+    
+    void preload_scene();
+    
+    void check_scene_changes();
 
   protected:
     virtual bool on_start() override;
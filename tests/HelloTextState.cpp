@@ -8,6 +8,7 @@
 #include <cassert>
 #include <ctime>
 #include <algorithm>
+#include <new> // std::nothrow
 #include <string>
 
 #include "lightsky/utils/DataResource.h"
@@ -27,6 +28,7 @@
 #include "Display.h"
 #include "HelloTextState.h"
 #include "ControlState.h"
+#include "WorkerPool.h"
 
 namespace math = ls::math;
 namespace draw = ls::draw;
@@ -280,8 +282,16 @@ HelloTextState::HelloTextState(HelloTextState&& state) :
 HelloTextState& HelloTextState::operator =(HelloTextState&& state) {
     GameState::operator =(std::move(state));
     
-    useOcclusionBuffer = state.useOcclusionBuffer;
-    state.useOcclusionBuffer = false;
+    cullMode = state.cullMode;
+    state.cullMode = TEXT_CULL_FRUSTUM;
+
+    useTemporalCulling = state.useTemporalCulling;
+    state.useTemporalCulling = true;
+
+    hasPendingOcclusion = state.hasPendingOcclusion;
+    state.hasPendingOcclusion = false;
+
+    pendingOcclusionFrustum = state.pendingOcclusionFrustum;
 
     textShader      = std::move(state.textShader);
     occlusionShader = std::move(state.occlusionShader);
@@ -293,6 +303,16 @@ HelloTextState& HelloTextState::operator =(HelloTextState&& state) {
     textMesh        = std::move(state.textMesh);
     occlusionMeshes = std::move(state.occlusionMeshes);
     meshesInScene   = std::move(state.meshesInScene);
+    cullCandidates  = std::move(state.cullCandidates);
+    frameCandidates = std::move(state.frameCandidates);
+    occlusionResults = std::move(state.occlusionResults);
+    textCullBounds  = std::move(state.textCullBounds);
+    frustumCuller   = std::move(state.frustumCuller);
+    softwareOcclusion = std::move(state.softwareOcclusion);
+    textVisCache    = std::move(state.textVisCache);
+    cullWorkers     = std::move(state.cullWorkers);
+    textLoader      = std::move(state.textLoader);
+    fontLoader      = std::move(state.fontLoader);
     
     currentPbo = state.currentPbo;
     state.currentPbo = 0;
@@ -304,6 +324,26 @@ HelloTextState& HelloTextState::operator =(HelloTextState&& state) {
     return *this;
 }
 
+/*-------------------------------------
+ * Read all text assets off of the game thread
+-------------------------------------*/
+void HelloTextState::load_text_assets() {
+    textLoader = std::async(std::launch::async, []()->std::string {
+        return load_test_text();
+    });
+
+    fontLoader = std::async(std::launch::async, []()->utils::Pointer<draw::FontResource> {
+        utils::Pointer<draw::FontResource> pFont{new(std::nothrow) draw::FontResource{}};
+
+        if (pFont != nullptr && !pFont->load_file(LS_GAME_TEST_FONT, 72)) {
+            LS_LOG_ERR("Unable to load the test font ", LS_GAME_TEST_FONT);
+            pFont.reset();
+        }
+
+        return pFont;
+    });
+}
+
 /*-------------------------------------
 -------------------------------------*/
 void HelloTextState::setup_text_shader() {
@@ -468,12 +508,11 @@ void HelloTextState::setup_occlusion_fbo() {
 /*-------------------------------------
 -------------------------------------*/
 void HelloTextState::setup_atlas() {
-    ls::utils::Pointer<draw::FontResource> pFont;
+    // Blocks only if the font is still being read from disk.
+    ls::utils::Pointer<draw::FontResource> pFont = fontLoader.get();
 
-    pFont.reset(new draw::FontResource {});
-
-    assert(pFont->load_file(LS_GAME_TEST_FONT, 72));
-    assert(atlas.init(*pFont));
+    LS_ASSERT(pFont != nullptr);
+    LS_ASSERT(atlas.init(*pFont));
 }
 
 /*-------------------------------------
@@ -554,6 +593,34 @@ void HelloTextState::setup_occluders() {
     LS_LOG_GL_ERR();
 }
 
+/*-------------------------------------
+ * Copy the text bounds into a SIMD-friendly layout for frustum culling.
+-------------------------------------*/
+void HelloTextState::setup_culling() {
+    const std::vector<draw::BoundingBox>& textBounds = textMesh.bounds;
+
+    textCullBounds.clear();
+    textCullBounds.reserve((unsigned)textBounds.size());
+
+    for (const draw::BoundingBox& box : textBounds) {
+        const math::vec3& trr = box.get_top_rear_right();
+        const math::vec3& bfl = box.get_bot_front_left();
+        const float minPos[3] = {std::min(trr[0], bfl[0]), std::min(trr[1], bfl[1]), std::min(trr[2], bfl[2])};
+        const float maxPos[3] = {std::max(trr[0], bfl[0]), std::max(trr[1], bfl[1]), std::max(trr[2], bfl[2])};
+        textCullBounds.push_back(minPos, maxPos);
+    }
+
+    // One worker per extra hardware thread, shared by frustum culling and
+    // the temporal cache's full updates.
+    cullWorkers.reset(new WorkerPool{});
+
+    // Same resolution as the GPU occlusion buffer
+    const math::vec3i& occlusionRes = occlusionTarget.get_size();
+    LS_ASSERT(softwareOcclusion.init((unsigned)occlusionRes[0], (unsigned)occlusionRes[1]));
+
+    LS_LOG_MSG("Frustum culling ", textCullBounds.size(), " text meshes using ", cullWorkers->get_concurrency(), " threads.");
+}
+
 /*-------------------------------------
 -------------------------------------*/
 void HelloTextState::setup_text() {
@@ -565,10 +632,10 @@ void HelloTextState::setup_text() {
         | common_vertex_t::INDEX_VERTEX
         | 0);
 
-    ls::utils::Pointer<draw::TextMeshLoader> textLoader {new draw::TextMeshLoader{}};
-    const std::string&& text = load_test_text();
-    const unsigned numTextIndices = textLoader->load(text, vertTypes, atlas, true);
-    textMesh = std::move(textLoader->get_mesh());
+    ls::utils::Pointer<draw::TextMeshLoader> meshLoader {new draw::TextMeshLoader{}};
+    const std::string&& text = textLoader.get();
+    const unsigned numTextIndices = meshLoader->load(text, vertTypes, atlas, true);
+    textMesh = std::move(meshLoader->get_mesh());
 
     LS_ASSERT(numTextIndices > 0);
 
@@ -648,9 +715,9 @@ void HelloTextState::read_occlusion_data() {
     const unsigned numPixels        = dimens[0] * dimens[1];
     const unsigned numBytes         = numPixels * components * bytesPerPixel;
     
-    
-    meshesInScene.clear();
-    meshesInScene.reserve(numBytes);
+    // Many pixels belong to the same mesh. Collapse them into a set so each
+    // mesh is drawn only once.
+    occlusionResults.reset((unsigned)textMesh.meshes.size());
     
     draw::FrameBuffer::bind_default_framebuffer(draw::fbo_access_t::FBO_ACCESS_W);
     LS_LOG_GL_ERR();
@@ -682,17 +749,13 @@ void HelloTextState::read_occlusion_data() {
         writePbo.bind();
         LS_LOG_GL_ERR();
 
-        const draw::color::colorub_t* const pPixels =
-            (draw::color::colorub_t*)writePbo.map_data(0, numBytes, draw::buffer_map_t::VBO_MAP_BIT_READ);
+        // RGBA8 pixels, with the mesh ID in the RGB channels
+        const uint32_t* const pPixels =
+            (const uint32_t*)writePbo.map_data(0, numBytes, draw::buffer_map_t::VBO_MAP_BIT_READ);
         LS_LOG_GL_ERR();
 
-        for (unsigned i = 0; i < numPixels; ++i) {
-            const draw::color::colorub_t c = pPixels[i];
-
-            if (c != draw::color::color_float_to_int<unsigned char>(draw::color::white)) {
-                const unsigned meshId = draw::color::color_to_id(c);
-                meshesInScene.push_back(meshId);
-            }
+        if (pPixels) {
+            occlusionResults.insert_id_buffer(pPixels, numPixels);
         }
 
         writePbo.unmap_data();
@@ -710,25 +773,114 @@ void HelloTextState::read_occlusion_data() {
     
     draw::FrameBuffer::bind_default_framebuffer(draw::fbo_access_t::FBO_ACCESS_RW);
     LS_LOG_GL_ERR();
+    
+    occlusionResults.get_ids(meshesInScene);
 }
 
 /*-------------------------------------
+ * Remove text outside of the camera's view. The temporal cache only
+ * re-tests meshes close enough to the frustum's edges to have changed.
 -------------------------------------*/
-void HelloTextState::do_frustum_cull(const ls::math::mat4& vpMatrix) {
-    
-    const std::vector<draw::BoundingBox>& textBounds = textMesh.bounds;
-    const math::mat4&& testTransform = vpMatrix * math::mat4{1.f};
-    
-    // standard implementations just do a memset() when clearing a vector rather
-    // than reallocate.
-    meshesInScene.clear();
-    meshesInScene.reserve(textBounds.size());
-    
-    for (unsigned i = 0; i < textBounds.size(); ++i) {
-        if (draw::is_visible(textBounds[i], testTransform, 1.15f)) {
-            meshesInScene.push_back(i);
-        }
+FrustumPlanes HelloTextState::do_frustum_cull(const ls::math::mat4& vpMatrix) {
+    // The text meshes use identity model matrices so their bounds are already
+    // in world-space.
+    const FrustumPlanes&& frustum = extract_frustum_planes(reinterpret_cast<const float*>(&vpMatrix), 1.15f);
+
+    if (useTemporalCulling) {
+        textVisCache.cull(frustum, textCullBounds, meshesInScene, cullWorkers.get());
+    }
+    else {
+        frustumCuller.cull(frustum, textCullBounds, meshesInScene, cullWorkers.get());
     }
+
+    return frustum;
+}
+
+/*-------------------------------------
+ * Render the text bounds on the GPU, reusing the last readback while the
+ * camera is nearly still.
+ *
+ * PBO readback returns the previous frame's pass, so each pass's frustum and
+ * candidates are kept until its result arrives. Results are only accepted
+ * from a pass issued on the previous frame; anything older is discarded.
+-------------------------------------*/
+void HelloTextState::do_gpu_occlusion_cull(const ls::math::mat4& vpMatrix) {
+    if (!useTemporalCulling) {
+        draw_occlusion_data(vpMatrix);
+        read_occlusion_data();
+        return;
+    }
+
+    const FrustumPlanes&& frustum = do_frustum_cull(vpMatrix);
+
+    if (textVisCache.can_reuse_occlusion(frustum)) {
+        // Any pass still in flight will be stale once GPU passes resume
+        hasPendingOcclusion = false;
+        textVisCache.reuse_occlusion(meshesInScene, meshesInScene);
+        return;
+    }
+
+    frameCandidates.swap(meshesInScene);
+    draw_occlusion_data(vpMatrix);
+    read_occlusion_data();
+
+    if (hasPendingOcclusion) {
+        textVisCache.store_occlusion(pendingOcclusionFrustum, cullCandidates, meshesInScene);
+        textVisCache.remove_occluded(frameCandidates, meshesInScene);
+    }
+    else {
+        // No readback belongs to the last frame, so draw everything in view
+        meshesInScene = frameCandidates;
+    }
+
+    pendingOcclusionFrustum = frustum;
+    cullCandidates.swap(frameCandidates);
+    hasPendingOcclusion = true;
+}
+
+/*-------------------------------------
+ * Rasterize the visible text bounds on the CPU and remove any which are
+ * hidden behind others.
+-------------------------------------*/
+void HelloTextState::do_software_occlusion_cull(const ls::math::mat4& vpMatrix) {
+    const FrustumPlanes&& frustum = do_frustum_cull(vpMatrix);
+    const float* const pVpMatrix = reinterpret_cast<const float*>(&vpMatrix);
+
+    if (!useTemporalCulling) {
+        softwareOcclusion.cull(pVpMatrix, textCullBounds, meshesInScene, meshesInScene, cullWorkers.get());
+        return;
+    }
+
+    if (textVisCache.can_reuse_occlusion(frustum)) {
+        textVisCache.reuse_occlusion(meshesInScene, meshesInScene);
+        return;
+    }
+
+    cullCandidates.swap(meshesInScene);
+    softwareOcclusion.cull(pVpMatrix, textCullBounds, cullCandidates, meshesInScene, cullWorkers.get());
+    textVisCache.store_occlusion(frustum, cullCandidates, meshesInScene);
+}
+
+/*-------------------------------------
+ * Report how much work the temporal cache avoided since the last report.
+-------------------------------------*/
+void HelloTextState::log_culling_stats() {
+    const unsigned long long numFrustumTests =
+        textVisCache.get_num_tests_performed() + textVisCache.get_num_tests_skipped();
+
+    if (numFrustumTests) {
+        LS_LOG_MSG(
+            "Temporal culling results:",
+            "\n\tFrustum tests performed:  ", textVisCache.get_num_tests_performed(),
+            "\n\tFrustum tests skipped:    ", textVisCache.get_num_tests_skipped(),
+            "\n\tFull frustum updates:     ", textVisCache.get_num_full_updates(),
+            "\n\tLinear frustum culls:     ", textVisCache.get_num_linear_culls(),
+            "\n\tOcclusion passes:         ", textVisCache.get_num_occlusion_passes(),
+            "\n\tOcclusion results reused: ", textVisCache.get_num_occlusion_reuses()
+        );
+    }
+
+    textVisCache.reset_counters();
 }
 
 /*-------------------------------------
@@ -814,13 +966,16 @@ bool HelloTextState::on_start() {
     using draw::ShaderAttribArray;
     using draw::VAOAttrib;
 
-    setup_atlas();
+    // File IO overlaps with shader compilation and FBO setup
+    load_text_assets();
     setup_text_shader();
     setup_occlusion_shader();
     setup_occlusion_fbo();
+    setup_atlas();
     setup_text();
     create_matrix_buffer();
     setup_occluders();
+    setup_culling();
 
     LS_DEBUG_ASSERT(draw::are_attribs_compatible(textShader, textMesh.renderData.vaos.front()));
     LS_LOG_GL_ERR();
@@ -838,25 +993,50 @@ void HelloTextState::on_run() {
     const ControlState* const pController = get_parent_system().get_game_state<ControlState>();
     const math::mat4& vpMat = pController->get_camera_view_projection();
     const utils::Pointer<bool[]>& pKeyStates = pController->get_key_states();
+    const text_cull_mode_t prevCullMode = cullMode;
+    const bool prevTemporalCulling = useTemporalCulling;
     
     if (pKeyStates[SDL_SCANCODE_O]) {
-        useOcclusionBuffer = true;
+        cullMode = TEXT_CULL_GPU_OCCLUSION;
     }
     else if (pKeyStates[SDL_SCANCODE_P]) {
-        useOcclusionBuffer = false;
+        cullMode = TEXT_CULL_FRUSTUM;
+    }
+    else if (pKeyStates[SDL_SCANCODE_I]) {
+        cullMode = TEXT_CULL_CPU_OCCLUSION;
+    }
+    
+    if (pKeyStates[SDL_SCANCODE_T]) {
+        useTemporalCulling = true;
+    }
+    else if (pKeyStates[SDL_SCANCODE_Y]) {
+        useTemporalCulling = false;
+    }
+    
+    // Occlusion results from one method shouldn't be reused by another.
+    if (cullMode != prevCullMode || useTemporalCulling != prevTemporalCulling) {
+        log_culling_stats();
+        textVisCache.invalidate();
+        hasPendingOcclusion = false;
     }
     
     glDisable(GL_CULL_FACE);
     LS_LOG_GL_ERR();
 
-    if (useOcclusionBuffer) {
-        draw_occlusion_data(vpMat);
-        read_occlusion_data();
-        
-        LS_LOG_GL_ERR();
-    }
-    else {
-        do_frustum_cull(vpMat);
+    switch (cullMode) {
+        case TEXT_CULL_GPU_OCCLUSION:
+            do_gpu_occlusion_cull(vpMat);
+            LS_LOG_GL_ERR();
+            break;
+
+        case TEXT_CULL_CPU_OCCLUSION:
+            do_software_occlusion_cull(vpMat);
+            break;
+
+        case TEXT_CULL_FRUSTUM:
+        default:
+            do_frustum_cull(vpMat);
+            break;
     }
     
     draw_text_data(vpMat);
@@ -866,7 +1046,11 @@ void HelloTextState::on_run() {
  * System Stop
 -------------------------------------*/
 void HelloTextState::on_stop() {
-    useOcclusionBuffer = false;
+    log_culling_stats();
+
+    cullMode = TEXT_CULL_FRUSTUM;
+    useTemporalCulling = true;
+    hasPendingOcclusion = false;
     
     textShader.terminate();
     occlusionShader.terminate();
@@ -887,4 +1071,11 @@ void HelloTextState::on_stop() {
     
     textBoxes.clear();
     meshesInScene.clear();
+    cullCandidates.clear();
+    frameCandidates.clear();
+    occlusionResults.reset(0);
+    textCullBounds.clear();
+    softwareOcclusion.terminate();
+    textVisCache.clear();
+    cullWorkers.reset();
 }
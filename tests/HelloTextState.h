@@ -8,11 +8,16 @@
 #ifndef HELLOTEXTSTATE_H
 #define HELLOTEXTSTATE_H
 
+#include <future>
+#include <string>
 #include <vector>
 
+#include "lightsky/utils/Pointer.h"
+
 #include "lightsky/draw/Atlas.h"
 #include "lightsky/draw/BoundingBox.h"
 #include "lightsky/draw/Camera.h"
+#include "lightsky/draw/FontResource.h"
 #include "lightsky/draw/FrameBuffer.h"
 #include "lightsky/draw/PixelBuffer.h"
 #include "lightsky/draw/RenderBuffer.h"
@@ -22,16 +27,38 @@
 
 #include "lightsky/game/GameState.h"
 
+#include "FrustumCulling.h"
+#include "OcclusionRasterizer.h"
+#include "VisibilityCache.h"
+#include "VisibilitySet.h"
+
 
 
 class ControlState;
+class WorkerPool;
+
+
+
+/**
+ * @brief Methods of culling text meshes which are not visible.
+ */
+enum text_cull_mode_t {
+    TEXT_CULL_FRUSTUM,
+    TEXT_CULL_GPU_OCCLUSION,
+    TEXT_CULL_CPU_OCCLUSION
+};
 
 
 
 class HelloTextState final : public ls::game::GameState {
     
   private:
-    bool useOcclusionBuffer = false;
+    text_cull_mode_t cullMode = TEXT_CULL_FRUSTUM;
+
+    bool useTemporalCulling = true;
+
+    // A GPU occlusion pass was issued last frame and its readback is due
+    bool hasPendingOcclusion = false;
 
     ls::draw::ShaderProgram textShader;
     
@@ -59,6 +86,29 @@ class HelloTextState final : public ls::game::GameState {
     
     std::vector<unsigned> meshesInScene;
     
+    // Candidates of the last occlusion pass
+    std::vector<unsigned> cullCandidates;
+    
+    std::vector<unsigned> frameCandidates;
+    
+    FrustumPlanes pendingOcclusionFrustum;
+    
+    VisibilitySet occlusionResults;
+    
+    CullingBounds textCullBounds;
+    
+    FrustumCuller frustumCuller;
+    
+    OcclusionRasterizer softwareOcclusion;
+    
+    VisibilityCache textVisCache;
+    
+    ls::utils::Pointer<WorkerPool> cullWorkers;
+    
+    std::future<std::string> textLoader;
+    
+    std::future<ls::utils::Pointer<ls::draw::FontResource>> fontLoader;
+    
   public:
     virtual ~HelloTextState();
 
@@ -73,6 +123,8 @@ class HelloTextState final : public ls::game::GameState {
     HelloTextState& operator=(HelloTextState&&);
 
   private:
+    void load_text_assets();
+    
     void setup_text_shader();
     
     void setup_occlusion_shader();
@@ -85,6 +137,8 @@ class HelloTextState final : public ls::game::GameState {
 
     void setup_occluders();
     
+    void setup_culling();
+    
     void create_matrix_buffer();
     
     void frustum_cull_text(const ls::math::mat4& vpMatrix);
@@ -95,7 +149,13 @@ class HelloTextState final : public ls::game::GameState {
     
     void read_occlusion_data();
     
-    void do_frustum_cull(const ls::math::mat4& vpMatrix);
+    FrustumPlanes do_frustum_cull(const ls::math::mat4& vpMatrix);
+    
+    void do_gpu_occlusion_cull(const ls::math::mat4& vpMatrix);
+    
+    void do_software_occlusion_cull(const ls::math::mat4& vpMatrix);
+    
+    void log_culling_stats();
     
     void draw_text_data(const ls::math::mat4& vpMatrix);
 
@@ -0,0 +1,549 @@
+/*
+ * File:   OcclusionRasterizer.cpp
+ */
+
+#include <algorithm> // std::min, std::max, std::fill
+#include <cmath> // std::floor, std::ceil, std::fabs
+#include <functional>
+#include <utility> // std::move, std::swap
+
+#include "FrustumCulling.h"
+#include "WorkerPool.h"
+#include "OcclusionRasterizer.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define LS_TEST_OCCLUSION_SSE 1
+#else
+    #define LS_TEST_OCCLUSION_SSE 0
+#endif
+
+
+
+/*-----------------------------------------------------------------------------
+ * Private rasterization helpers
+-----------------------------------------------------------------------------*/
+namespace {
+
+enum : unsigned {
+    // Width and height of each tile in the max-depth hierarchy
+    OCCLUSION_TILE_SIZE = 8,
+
+    // Number of boxes projected or tested by each task
+    OCCLUSION_BOXES_PER_TASK = 1024,
+
+    // Number of bands of tiles assigned to each thread, for load balancing
+    OCCLUSION_BANDS_PER_THREAD = 2
+};
+
+// Boxes with a corner closer than this (in clip-space W) are considered to
+// cross the near plane.
+constexpr float OCCLUSION_MIN_W = 1.0e-5f;
+
+// Interpolated depth can be slightly nearer than a box's nearest corner due
+// to rounding. Without this, boxes could hide behind themselves.
+constexpr float OCCLUSION_DEPTH_BIAS = 1.0e-5f;
+
+/*-------------------------------------
+ * Box corner indices for each triangle. Corner bits are ordered as
+ * (x, y, z), where a set bit selects the maximum extent along that axis.
+-------------------------------------*/
+constexpr unsigned char BOX_TRIANGLES[12][3] = {
+    {0, 2, 6}, {0, 6, 4}, // -X
+    {1, 5, 7}, {1, 7, 3}, // +X
+    {0, 4, 5}, {0, 5, 1}, // -Y
+    {2, 3, 7}, {2, 7, 6}, // +Y
+    {0, 1, 3}, {0, 3, 2}, // -Z
+    {4, 6, 7}, {4, 7, 5}  // +Z
+};
+
+/*-------------------------------------
+ * Run tasks on a thread pool, if available
+-------------------------------------*/
+inline void run_tasks(WorkerPool* pWorkers, const unsigned numTasks, const std::function<void(unsigned)>& taskFunc) noexcept {
+    if (pWorkers) {
+        pWorkers->run(numTasks, taskFunc);
+        return;
+    }
+
+    for (unsigned i = 0; i < numTasks; ++i) {
+        taskFunc(i);
+    }
+}
+
+/*-------------------------------------
+ * Screen-space edge equation: E(x, y) = a*x + b*y + c
+-------------------------------------*/
+struct EdgeEquation {
+    float a, b, c;
+
+    EdgeEquation(const float x0, const float y0, const float x1, const float y1) noexcept :
+        a{y0 - y1},
+        b{x1 - x0},
+        c{-(y0 - y1)*x0 - (x1 - x0)*y0}
+    {}
+};
+
+} // end anonymous namespace
+
+
+
+/*-----------------------------------------------------------------------------
+ * Occlusion Rasterizer
+-----------------------------------------------------------------------------*/
+/*-------------------------------------
+ * Destructor
+-------------------------------------*/
+OcclusionRasterizer::~OcclusionRasterizer() noexcept {
+}
+
+/*-------------------------------------
+ * Constructor
+-------------------------------------*/
+OcclusionRasterizer::OcclusionRasterizer() noexcept :
+    width{0},
+    height{0},
+    numTilesX{0},
+    numTilesY{0},
+    numOccluders{0},
+    depthBuffer{},
+    tileMaxDepth{},
+    screenBoxes{},
+    visibility{}
+{}
+
+/*-------------------------------------
+ * Move Constructor
+-------------------------------------*/
+OcclusionRasterizer::OcclusionRasterizer(OcclusionRasterizer&& r) noexcept :
+    OcclusionRasterizer{}
+{
+    *this = std::move(r);
+}
+
+/*-------------------------------------
+ * Move Operator
+-------------------------------------*/
+OcclusionRasterizer& OcclusionRasterizer::operator=(OcclusionRasterizer&& r) noexcept {
+    width = r.width;
+    r.width = 0;
+
+    height = r.height;
+    r.height = 0;
+
+    numTilesX = r.numTilesX;
+    r.numTilesX = 0;
+
+    numTilesY = r.numTilesY;
+    r.numTilesY = 0;
+
+    numOccluders = r.numOccluders;
+    r.numOccluders = 0;
+
+    depthBuffer = std::move(r.depthBuffer);
+    tileMaxDepth = std::move(r.tileMaxDepth);
+    screenBoxes = std::move(r.screenBoxes);
+    visibility = std::move(r.visibility);
+
+    return *this;
+}
+
+/*-------------------------------------
+ * Allocate the depth buffer
+-------------------------------------*/
+bool OcclusionRasterizer::init(const unsigned w, const unsigned h) {
+    if (!w || !h) {
+        return false;
+    }
+
+    terminate();
+
+    numTilesX = (w + OCCLUSION_TILE_SIZE - 1) / OCCLUSION_TILE_SIZE;
+    numTilesY = (h + OCCLUSION_TILE_SIZE - 1) / OCCLUSION_TILE_SIZE;
+    width = numTilesX * OCCLUSION_TILE_SIZE;
+    height = numTilesY * OCCLUSION_TILE_SIZE;
+
+    depthBuffer.resize(width * height, 1.f);
+    tileMaxDepth.resize(numTilesX * numTilesY, 1.f);
+
+    return true;
+}
+
+/*-------------------------------------
+ * Free all memory
+-------------------------------------*/
+void OcclusionRasterizer::terminate() noexcept {
+    width = 0;
+    height = 0;
+    numTilesX = 0;
+    numTilesY = 0;
+    numOccluders = 0;
+
+    depthBuffer.clear();
+    depthBuffer.shrink_to_fit();
+
+    tileMaxDepth.clear();
+    tileMaxDepth.shrink_to_fit();
+
+    screenBoxes.clear();
+    screenBoxes.shrink_to_fit();
+
+    visibility.clear();
+    visibility.shrink_to_fit();
+}
+
+/*-------------------------------------
+ * Transform box corners into screen space
+-------------------------------------*/
+void OcclusionRasterizer::project_boxes(
+    const float* m,
+    const CullingBounds& bounds,
+    const unsigned* pCandidates,
+    const unsigned begin,
+    const unsigned end
+) noexcept {
+    const float halfW = 0.5f * (float)width;
+    const float halfH = 0.5f * (float)height;
+
+    for (unsigned i = begin; i < end; ++i) {
+        float boxMin[3], boxMax[3];
+        bounds.get_bounds(pCandidates[i], boxMin, boxMax);
+
+        ScreenBox& box = screenBoxes[i];
+        box.minX = box.minY = box.minZ = 1.e30f;
+        box.maxX = box.maxY = -1.e30f;
+        box.isNearClipped = false;
+
+        for (unsigned c = 0; c < 8; ++c) {
+            const float x = (c & 1u) ? boxMax[0] : boxMin[0];
+            const float y = (c & 2u) ? boxMax[1] : boxMin[1];
+            const float z = (c & 4u) ? boxMax[2] : boxMin[2];
+
+            const float cx = m[0]*x + m[4]*y + m[8]*z  + m[12];
+            const float cy = m[1]*x + m[5]*y + m[9]*z  + m[13];
+            const float cz = m[2]*x + m[6]*y + m[10]*z + m[14];
+            const float cw = m[3]*x + m[7]*y + m[11]*z + m[15];
+
+            // Corners behind or in front of the near plane can't be projected
+            if (cw < OCCLUSION_MIN_W || cz < -cw) {
+                box.isNearClipped = true;
+                break;
+            }
+
+            const float invW = 1.f / cw;
+            const float sx = (cx * invW + 1.f) * halfW;
+            const float sy = (cy * invW + 1.f) * halfH;
+            const float sz = (cz * invW + 1.f) * 0.5f;
+
+            box.x[c] = sx;
+            box.y[c] = sy;
+            box.z[c] = sz;
+
+            box.minX = std::min(box.minX, sx);
+            box.minY = std::min(box.minY, sy);
+            box.maxX = std::max(box.maxX, sx);
+            box.maxY = std::max(box.maxY, sy);
+            box.minZ = std::min(box.minZ, sz);
+        }
+    }
+}
+
+/*-------------------------------------
+ * Rasterize a single triangle, clipped to a band of rows
+-------------------------------------*/
+void OcclusionRasterizer::rasterize_triangle(
+    const ScreenBox& box,
+    const unsigned i0,
+    unsigned i1,
+    unsigned i2,
+    const int bandMinY,
+    const int bandMaxY
+) noexcept {
+    float area = (box.x[i1] - box.x[i0]) * (box.y[i2] - box.y[i0]) - (box.x[i2] - box.x[i0]) * (box.y[i1] - box.y[i0]);
+
+    // Both windings are rasterized since only the nearest depth is kept.
+    if (area < 0.f) {
+        std::swap(i1, i2);
+        area = -area;
+    }
+
+    if (area < 1.0e-8f) {
+        return;
+    }
+
+    const float x0 = box.x[i0], y0 = box.y[i0], z0 = box.z[i0];
+    const float x1 = box.x[i1], y1 = box.y[i1], z1 = box.z[i1];
+    const float x2 = box.x[i2], y2 = box.y[i2], z2 = box.z[i2];
+
+    const int minX = std::max(0, (int)std::floor(std::min(x0, std::min(x1, x2))));
+    const int maxX = std::min((int)width - 1, (int)std::ceil(std::max(x0, std::max(x1, x2))));
+    const int minY = std::max(bandMinY, (int)std::floor(std::min(y0, std::min(y1, y2))));
+    const int maxY = std::min(bandMaxY - 1, (int)std::ceil(std::max(y0, std::max(y1, y2))));
+
+    if (minX > maxX || minY > maxY) {
+        return;
+    }
+
+    // Each edge is positive on the side of the opposite vertex
+    const EdgeEquation e12{x1, y1, x2, y2};
+    const EdgeEquation e20{x2, y2, x0, y0};
+    const EdgeEquation e01{x0, y0, x1, y1};
+
+    // Depth is linear in screen-space after the perspective divide
+    const float invArea = 1.f / area;
+    const float za = (e12.a*z0 + e20.a*z1 + e01.a*z2) * invArea;
+    const float zb = (e12.b*z0 + e20.b*z1 + e01.b*z2) * invArea;
+    const float zc = (e12.c*z0 + e20.c*z1 + e01.c*z2) * invArea;
+
+    #if LS_TEST_OCCLUSION_SSE
+        // The depth buffer's width is a multiple of 4 so aligning the start
+        // of each row never reads or writes past the end of a row.
+        const int startX = minX & ~3;
+        const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 e12a = _mm_set1_ps(e12.a);
+        const __m128 e20a = _mm_set1_ps(e20.a);
+        const __m128 e01a = _mm_set1_ps(e01.a);
+        const __m128 zA = _mm_set1_ps(za);
+
+        for (int y = minY; y <= maxY; ++y) {
+            const float py = (float)y + 0.5f;
+            const __m128 row12 = _mm_set1_ps(e12.b*py + e12.c);
+            const __m128 row20 = _mm_set1_ps(e20.b*py + e20.c);
+            const __m128 row01 = _mm_set1_ps(e01.b*py + e01.c);
+            const __m128 rowZ = _mm_set1_ps(zb*py + zc);
+            float* const pRow = depthBuffer.data() + y * width;
+
+            for (int x = startX; x <= maxX; x += 4) {
+                const __m128 px = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+                const __m128 w0 = _mm_add_ps(_mm_mul_ps(e12a, px), row12);
+                const __m128 w1 = _mm_add_ps(_mm_mul_ps(e20a, px), row20);
+                const __m128 w2 = _mm_add_ps(_mm_mul_ps(e01a, px), row01);
+
+                const __m128 inside = _mm_and_ps(
+                    _mm_cmpge_ps(w0, zero),
+                    _mm_and_ps(_mm_cmpge_ps(w1, zero), _mm_cmpge_ps(w2, zero))
+                );
+
+                if (!_mm_movemask_ps(inside)) {
+                    continue;
+                }
+
+                const __m128 depth = _mm_add_ps(_mm_mul_ps(zA, px), rowZ);
+                const __m128 prev = _mm_loadu_ps(pRow + x);
+                const __m128 nearest = _mm_min_ps(prev, depth);
+                _mm_storeu_ps(pRow + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, prev)));
+            }
+        }
+    #else
+        for (int y = minY; y <= maxY; ++y) {
+            const float py = (float)y + 0.5f;
+            float* const pRow = depthBuffer.data() + y * width;
+
+            for (int x = minX; x <= maxX; ++x) {
+                const float px = (float)x + 0.5f;
+                const float w0 = e12.a*px + e12.b*py + e12.c;
+                const float w1 = e20.a*px + e20.b*py + e20.c;
+                const float w2 = e01.a*px + e01.b*py + e01.c;
+
+                if (w0 >= 0.f && w1 >= 0.f && w2 >= 0.f) {
+                    pRow[x] = std::min(pRow[x], za*px + zb*py + zc);
+                }
+            }
+        }
+    #endif
+}
+
+/*-------------------------------------
+ * Rasterize all occluders within a band of tile rows
+-------------------------------------*/
+void OcclusionRasterizer::rasterize_band(const unsigned tileRowBegin, const unsigned tileRowEnd) noexcept {
+    const int bandMinY = (int)(tileRowBegin * OCCLUSION_TILE_SIZE);
+    const int bandMaxY = (int)(tileRowEnd * OCCLUSION_TILE_SIZE);
+
+    std::fill(depthBuffer.begin() + bandMinY * width, depthBuffer.begin() + bandMaxY * width, 1.f);
+
+    for (const ScreenBox& box : screenBoxes) {
+        if (box.isNearClipped
+        || box.maxY < (float)bandMinY
+        || box.minY >= (float)bandMaxY
+        || box.maxX < 0.f
+        || box.minX >= (float)width
+        ) {
+            continue;
+        }
+
+        for (const unsigned char* tri : BOX_TRIANGLES) {
+            rasterize_triangle(box, tri[0], tri[1], tri[2], bandMinY, bandMaxY);
+        }
+    }
+
+    // Update the max-depth of each tile in this band
+    for (unsigned ty = tileRowBegin; ty < tileRowEnd; ++ty) {
+        for (unsigned tx = 0; tx < numTilesX; ++tx) {
+            const float* pTile = depthBuffer.data() + (ty * width + tx) * OCCLUSION_TILE_SIZE;
+            float maxDepth = 0.f;
+
+            for (unsigned y = 0; y < OCCLUSION_TILE_SIZE; ++y, pTile += width) {
+                for (unsigned x = 0; x < OCCLUSION_TILE_SIZE; ++x) {
+                    maxDepth = std::max(maxDepth, pTile[x]);
+                }
+            }
+
+            tileMaxDepth[ty * numTilesX + tx] = maxDepth;
+        }
+    }
+}
+
+/*-------------------------------------
+ * Test a box against the depth hierarchy
+-------------------------------------*/
+bool OcclusionRasterizer::is_box_occluded(const ScreenBox& box) const noexcept {
+    if (box.isNearClipped) {
+        return false;
+    }
+
+    // All pixels touched by the box, not only those containing its centers
+    const int minX = std::max(0, (int)std::floor(box.minX));
+    const int maxX = std::min((int)width - 1, (int)std::floor(box.maxX));
+    const int minY = std::max(0, (int)std::floor(box.minY));
+    const int maxY = std::min((int)height - 1, (int)std::floor(box.maxY));
+
+    if (minX > maxX || minY > maxY) {
+        return true;
+    }
+
+    const float boxDepth = box.minZ - OCCLUSION_DEPTH_BIAS;
+    const int tileSize = (int)OCCLUSION_TILE_SIZE;
+
+    for (int ty = minY / tileSize; ty <= maxY / tileSize; ++ty) {
+        for (int tx = minX / tileSize; tx <= maxX / tileSize; ++tx) {
+            // Every pixel in this tile is nearer than the box
+            if (tileMaxDepth[ty * numTilesX + tx] < boxDepth) {
+                continue;
+            }
+
+            const int tileX = tx * tileSize;
+            const int tileY = ty * tileSize;
+            const int x0 = std::max(minX, tileX);
+            const int x1 = std::min(maxX, tileX + tileSize - 1);
+            const int y0 = std::max(minY, tileY);
+            const int y1 = std::min(maxY, tileY + tileSize - 1);
+
+            // The farthest pixel in the tile must be covered by the box
+            if (x0 == tileX && y0 == tileY && x1 == tileX + tileSize - 1 && y1 == tileY + tileSize - 1) {
+                return false;
+            }
+
+            #if LS_TEST_OCCLUSION_SSE
+                const __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+                const __m128i firstX = _mm_set1_epi32(x0 - 1);
+                const __m128i lastX = _mm_set1_epi32(x1 + 1);
+                const __m128 depth = _mm_set1_ps(boxDepth);
+
+                for (int y = y0; y <= y1; ++y) {
+                    const float* const pRow = depthBuffer.data() + y * width;
+
+                    for (int x = tileX; x < tileX + tileSize; x += 4) {
+                        const __m128i px = _mm_add_epi32(_mm_set1_epi32(x), lanes);
+                        const __m128i inRange = _mm_and_si128(_mm_cmpgt_epi32(px, firstX), _mm_cmplt_epi32(px, lastX));
+                        const __m128 farther = _mm_cmpge_ps(_mm_loadu_ps(pRow + x), depth);
+
+                        if (_mm_movemask_ps(_mm_and_ps(farther, _mm_castsi128_ps(inRange)))) {
+                            return false;
+                        }
+                    }
+                }
+            #else
+                for (int y = y0; y <= y1; ++y) {
+                    const float* const pRow = depthBuffer.data() + y * width;
+
+                    for (int x = x0; x <= x1; ++x) {
+                        if (pRow[x] >= boxDepth) {
+                            return false;
+                        }
+                    }
+                }
+            #endif
+        }
+    }
+
+    return true;
+}
+
+/*-------------------------------------
+ * Rasterize and test all candidates
+-------------------------------------*/
+unsigned OcclusionRasterizer::cull(
+    const float* pVpMatrix,
+    const CullingBounds& bounds,
+    const std::vector<unsigned>& candidates,
+    std::vector<unsigned>& outVisible,
+    WorkerPool* pWorkers
+) {
+    const unsigned numBoxes = (unsigned)candidates.size();
+
+    numOccluders = 0;
+
+    if (!width || !height || !numBoxes) {
+        outVisible = candidates;
+        return numBoxes;
+    }
+
+    screenBoxes.resize(numBoxes);
+    visibility.resize(numBoxes);
+
+    const unsigned* const pCandidates = candidates.data();
+    const unsigned numBoxTasks = (numBoxes + OCCLUSION_BOXES_PER_TASK - 1) / OCCLUSION_BOXES_PER_TASK;
+
+    const std::function<void(unsigned)> projectTask = [&](unsigned taskId)->void {
+        const unsigned begin = taskId * OCCLUSION_BOXES_PER_TASK;
+        const unsigned end = std::min(begin + OCCLUSION_BOXES_PER_TASK, numBoxes);
+        project_boxes(pVpMatrix, bounds, pCandidates, begin, end);
+    };
+
+    run_tasks(pWorkers, numBoxTasks, projectTask);
+
+    for (const ScreenBox& box : screenBoxes) {
+        numOccluders += box.isNearClipped ? 0 : 1;
+    }
+
+    // Each band of tile rows owns its section of the depth buffer, so no
+    // synchronization is needed while rasterizing.
+    const unsigned concurrency = pWorkers ? pWorkers->get_concurrency() : 1u;
+    const unsigned numBands = std::min(numTilesY, concurrency * OCCLUSION_BANDS_PER_THREAD);
+    const unsigned rowsPerBand = (numTilesY + numBands - 1) / numBands;
+    const unsigned numBandTasks = (numTilesY + rowsPerBand - 1) / rowsPerBand;
+
+    const std::function<void(unsigned)> rasterTask = [&](unsigned taskId)->void {
+        const unsigned begin = taskId * rowsPerBand;
+        const unsigned end = std::min(begin + rowsPerBand, numTilesY);
+        rasterize_band(begin, end);
+    };
+
+    run_tasks(pWorkers, numBandTasks, rasterTask);
+
+    const std::function<void(unsigned)> testTask = [&](unsigned taskId)->void {
+        const unsigned begin = taskId * OCCLUSION_BOXES_PER_TASK;
+        const unsigned end = std::min(begin + OCCLUSION_BOXES_PER_TASK, numBoxes);
+
+        for (unsigned i = begin; i < end; ++i) {
+            visibility[i] = is_box_occluded(screenBoxes[i]) ? 0 : 1;
+        }
+    };
+
+    run_tasks(pWorkers, numBoxTasks, testTask);
+
+    // Compaction works in-place if the candidates and output are the same
+    outVisible.resize(numBoxes);
+    unsigned numVisible = 0;
+
+    for (unsigned i = 0; i < numBoxes; ++i) {
+        outVisible[numVisible] = pCandidates[i];
+        numVisible += visibility[i];
+    }
+
+    outVisible.resize(numVisible);
+
+    return numVisible;
+}
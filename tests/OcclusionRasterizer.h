@@ -0,0 +1,202 @@
+/*
+ * File:   OcclusionRasterizer.h
+ */
+
+#ifndef OCCLUSIONRASTERIZER_H
+#define OCCLUSIONRASTERIZER_H
+
+#include <vector>
+
+
+
+class CullingBounds;
+class WorkerPool;
+
+
+
+/**----------------------------------------------------------------------------
+ * Software occlusion culling of axis-aligned bounding boxes.
+ *
+ * Boxes are rasterized as occluders into a low-resolution depth buffer on the
+ * CPU, then tested as occludees against an 8x8 tile max-depth hierarchy. The
+ * results are available in the same frame, without reading anything back
+ * from the GPU.
+ *
+ * Depth values are stored in the range [0, 1], where 1 is the far plane.
+ * Results are conservative: boxes crossing the near plane are never used as
+ * occluders and are always reported as visible.
+-----------------------------------------------------------------------------*/
+class OcclusionRasterizer {
+  public:
+    /**
+     * @brief Projected corners and screen-space extents of a box.
+     */
+    struct ScreenBox {
+        float x[8];
+        float y[8];
+        float z[8];
+
+        float minX;
+        float minY;
+        float maxX;
+        float maxY;
+        float minZ;
+
+        bool isNearClipped;
+    };
+
+  private:
+    unsigned width;
+
+    unsigned height;
+
+    unsigned numTilesX;
+
+    unsigned numTilesY;
+
+    unsigned numOccluders;
+
+    std::vector<float> depthBuffer;
+
+    std::vector<float> tileMaxDepth;
+
+    std::vector<ScreenBox> screenBoxes;
+
+    std::vector<unsigned char> visibility;
+
+    void project_boxes(
+        const float* pVpMatrix,
+        const CullingBounds& bounds,
+        const unsigned* pCandidates,
+        const unsigned begin,
+        const unsigned end
+    ) noexcept;
+
+    void rasterize_band(const unsigned tileRowBegin, const unsigned tileRowEnd) noexcept;
+
+    void rasterize_triangle(
+        const ScreenBox& box,
+        const unsigned i0,
+        unsigned i1,
+        unsigned i2,
+        const int bandMinY,
+        const int bandMaxY
+    ) noexcept;
+
+    bool is_box_occluded(const ScreenBox& box) const noexcept;
+
+  public:
+    ~OcclusionRasterizer() noexcept;
+
+    OcclusionRasterizer() noexcept;
+
+    OcclusionRasterizer(const OcclusionRasterizer&) = default;
+
+    OcclusionRasterizer(OcclusionRasterizer&&) noexcept;
+
+    OcclusionRasterizer& operator=(const OcclusionRasterizer&) = default;
+
+    OcclusionRasterizer& operator=(OcclusionRasterizer&&) noexcept;
+
+    /**
+     * @brief Allocate the depth buffer.
+     *
+     * @param w
+     * The horizontal resolution. This is rounded up to a multiple of 8.
+     *
+     * @param h
+     * The vertical resolution. This is rounded up to a multiple of 8.
+     *
+     * @return TRUE if the depth buffer was allocated, FALSE if either
+     * dimension was 0.
+     */
+    bool init(const unsigned w, const unsigned h);
+
+    /**
+     * @brief Free all memory used by the rasterizer.
+     */
+    void terminate() noexcept;
+
+    /**
+     * @brief Retrieve the horizontal resolution of the depth buffer.
+     */
+    unsigned get_width() const noexcept;
+
+    /**
+     * @brief Retrieve the vertical resolution of the depth buffer.
+     */
+    unsigned get_height() const noexcept;
+
+    /**
+     * @brief Retrieve the number of boxes rasterized during the last call to
+     * cull().
+     */
+    unsigned get_num_occluders() const noexcept;
+
+    /**
+     * @brief Retrieve the depth buffer from the last call to cull(), stored
+     * in row-major order, bottom row first.
+     */
+    const float* get_depth_buffer() const noexcept;
+
+    /**
+     * @brief Rasterize a set of boxes and determine which of them are not
+     * hidden behind the others.
+     *
+     * @param pVpMatrix
+     * 16 floats containing a column-major view-projection matrix with an
+     * OpenGL clip space (-w <= z <= w).
+     *
+     * @param bounds
+     * World-space bounding boxes.
+     *
+     * @param candidates
+     * Indices of the boxes in "bounds" to rasterize and test, typically the
+     * output of a FrustumCuller. These act as both occluders and occludees.
+     *
+     * @param outVisible
+     * Replaced with the candidates which are not occluded, in the same order
+     * as the input. This may be the same object as "candidates".
+     *
+     * @param pWorkers
+     * If not NULL, projection, rasterization, and testing are split across
+     * these threads. Rasterization is split by rows of screen tiles.
+     *
+     * @return The number of visible boxes.
+     */
+    unsigned cull(
+        const float* pVpMatrix,
+        const CullingBounds& bounds,
+        const std::vector<unsigned>& candidates,
+        std::vector<unsigned>& outVisible,
+        WorkerPool* pWorkers = nullptr
+    );
+};
+
+
+
+inline unsigned OcclusionRasterizer::get_width() const noexcept {
+    return width;
+}
+
+
+
+inline unsigned OcclusionRasterizer::get_height() const noexcept {
+    return height;
+}
+
+
+
+inline unsigned OcclusionRasterizer::get_num_occluders() const noexcept {
+    return numOccluders;
+}
+
+
+
+inline const float* OcclusionRasterizer::get_depth_buffer() const noexcept {
+    return depthBuffer.data();
+}
+
+
+
+#endif  /* OCCLUSIONRASTERIZER_H */
@@ -0,0 +1,415 @@
+/*
+ * File:   VisibilityCache.cpp
+ */
+
+#include <algorithm> // std::sort, std::set_symmetric_difference, std::min, std::max
+#include <cmath> // std::sqrt, std::fabs
+#include <iterator> // std::back_inserter
+#include <utility> // std::move
+
+#include "VisibilityCache.h"
+
+
+
+/*-----------------------------------------------------------------------------
+ * Private helpers
+-----------------------------------------------------------------------------*/
+namespace {
+
+/*-------------------------------------
+ * Plane movement bound
+ *
+ * For any point within "radius" of the origin, the signed distance to a plane
+ * can change by at most |n1 - n0| * radius + |d1 - d0|. A box's distance to
+ * the frustum is a min/max of its corners' distances, so it is bounded by
+ * the same amount.
+-------------------------------------*/
+float get_plane_delta(const FrustumPlanes& a, const FrustumPlanes& b, const float radius) noexcept {
+    float delta = 0.f;
+
+    for (unsigned p = 0; p < 6; ++p) {
+        const float* const pa = a.planes[p];
+        const float* const pb = b.planes[p];
+        const float dx = pa[0] - pb[0];
+        const float dy = pa[1] - pb[1];
+        const float dz = pa[2] - pb[2];
+        const float planeDelta = std::sqrt(dx*dx + dy*dy + dz*dz) * radius + std::fabs(pa[3] - pb[3]);
+
+        delta = std::max(delta, planeDelta);
+    }
+
+    return delta;
+}
+
+/*-------------------------------------
+ * Radius of a sphere at the origin containing every box
+-------------------------------------*/
+float get_bounds_radius(const CullingBounds& bounds) noexcept {
+    const unsigned numBoxes = bounds.size();
+    float maxExtent = 0.f;
+
+    for (unsigned s = 0; s < CULL_BOUNDS_NUM_STREAMS; ++s) {
+        const float* const pStream = bounds.get_stream((cull_bounds_stream_t)s);
+
+        for (unsigned i = 0; i < numBoxes; ++i) {
+            maxExtent = std::max(maxExtent, std::fabs(pStream[i]));
+        }
+    }
+
+    // The largest component of any corner, scaled to cover the diagonal
+    return maxExtent * std::sqrt(3.f);
+}
+
+} // end anonymous namespace
+
+
+
+/*-----------------------------------------------------------------------------
+ * Visibility Cache
+-----------------------------------------------------------------------------*/
+constexpr unsigned VisibilityCache::NUM_SLACK_BUCKETS;
+constexpr unsigned VisibilityCache::MAX_RETEST_RATIO;
+
+/*-------------------------------------
+ * Destructor
+-------------------------------------*/
+VisibilityCache::~VisibilityCache() noexcept {
+}
+
+/*-------------------------------------
+ * Constructor
+-------------------------------------*/
+VisibilityCache::VisibilityCache(const float maxFrustumChange, const float maxOcclusionChange) noexcept :
+    hasReference{false},
+    hasOcclusionResult{false},
+    sceneRadius{0.f},
+    maxFrustumDelta{maxFrustumChange},
+    maxOcclusionDelta{maxOcclusionChange},
+    bucketScale{0.f},
+    refFrustum(),
+    occlusionFrustum(),
+    culler{},
+    slack{},
+    slackBuckets{},
+    retestOrder{},
+    bucketEnds{},
+    refVisible{},
+    refVisibleIds{},
+    changedIds{},
+    occludedBoxes{},
+    numTestsPerformed{0},
+    numTestsSkipped{0},
+    numFullUpdates{0},
+    numLinearCulls{0},
+    numOcclusionPasses{0},
+    numOcclusionReuses{0}
+{}
+
+/*-------------------------------------
+ * Move Constructor
+-------------------------------------*/
+VisibilityCache::VisibilityCache(VisibilityCache&& vc) noexcept :
+    VisibilityCache{}
+{
+    *this = std::move(vc);
+}
+
+/*-------------------------------------
+ * Move Operator
+-------------------------------------*/
+VisibilityCache& VisibilityCache::operator=(VisibilityCache&& vc) noexcept {
+    hasReference = vc.hasReference;
+    vc.hasReference = false;
+
+    hasOcclusionResult = vc.hasOcclusionResult;
+    vc.hasOcclusionResult = false;
+
+    sceneRadius = vc.sceneRadius;
+    vc.sceneRadius = 0.f;
+
+    maxFrustumDelta = vc.maxFrustumDelta;
+    maxOcclusionDelta = vc.maxOcclusionDelta;
+
+    bucketScale = vc.bucketScale;
+    vc.bucketScale = 0.f;
+
+    refFrustum = vc.refFrustum;
+    occlusionFrustum = vc.occlusionFrustum;
+    culler = std::move(vc.culler);
+
+    slack = std::move(vc.slack);
+    slackBuckets = std::move(vc.slackBuckets);
+    retestOrder = std::move(vc.retestOrder);
+    bucketEnds = std::move(vc.bucketEnds);
+    refVisible = std::move(vc.refVisible);
+    refVisibleIds = std::move(vc.refVisibleIds);
+    changedIds = std::move(vc.changedIds);
+    occludedBoxes = std::move(vc.occludedBoxes);
+
+    numTestsPerformed = vc.numTestsPerformed;
+    numTestsSkipped = vc.numTestsSkipped;
+    numFullUpdates = vc.numFullUpdates;
+    numLinearCulls = vc.numLinearCulls;
+    numOcclusionPasses = vc.numOcclusionPasses;
+    numOcclusionReuses = vc.numOcclusionReuses;
+    vc.reset_counters();
+
+    return *this;
+}
+
+/*-------------------------------------
+ * Discard cached results
+-------------------------------------*/
+void VisibilityCache::invalidate() noexcept {
+    hasReference = false;
+    hasOcclusionResult = false;
+}
+
+/*-------------------------------------
+ * Free all memory
+-------------------------------------*/
+void VisibilityCache::clear() noexcept {
+    invalidate();
+    sceneRadius = 0.f;
+    bucketScale = 0.f;
+
+    slack.clear();
+    slackBuckets.clear();
+    retestOrder.clear();
+    bucketEnds.clear();
+    refVisible.clear();
+    refVisibleIds.clear();
+    changedIds.clear();
+    occludedBoxes.reset(0);
+
+    reset_counters();
+}
+
+/*-------------------------------------
+ * Reset statistics
+-------------------------------------*/
+void VisibilityCache::reset_counters() noexcept {
+    numTestsPerformed = 0;
+    numTestsSkipped = 0;
+    numFullUpdates = 0;
+    numLinearCulls = 0;
+    numOcclusionPasses = 0;
+    numOcclusionReuses = 0;
+}
+
+/*-------------------------------------
+ * Camera movement since the last full update
+-------------------------------------*/
+float VisibilityCache::get_frustum_delta(const FrustumPlanes& frustum) const noexcept {
+    return get_plane_delta(frustum, refFrustum, sceneRadius);
+}
+
+/*-------------------------------------
+ * Test every box against a new reference frustum
+-------------------------------------*/
+void VisibilityCache::full_update(const FrustumPlanes& frustum, const CullingBounds& bounds, WorkerPool* pWorkers) {
+    const unsigned numBoxes = bounds.size();
+
+    // Boxes don't move between invalidations, so the radius only changes
+    // when there's no reference yet.
+    if (!hasReference) {
+        sceneRadius = get_bounds_radius(bounds);
+    }
+
+    refFrustum = frustum;
+    hasReference = true;
+
+    culler.get_distances(frustum, bounds, slack, pWorkers);
+
+    // Boxes further than this from every plane force a full update before
+    // they could change, so they are never re-tested.
+    const float maxSlack = maxFrustumDelta * sceneRadius;
+    bucketScale = maxSlack > 0.f ? ((float)NUM_SLACK_BUCKETS / maxSlack) : 0.f;
+
+    // Counting sort of the nearby boxes by their slack bucket. Boxes within
+    // a bucket are always re-tested together, so they don't need ordering.
+    // Far boxes are placed in an extra bucket which is never re-tested.
+    unsigned bucketCounts[NUM_SLACK_BUCKETS + 1] = {0};
+    unsigned numVisible = 0;
+
+    slackBuckets.resize(numBoxes);
+    refVisible.resize(numBoxes);
+    refVisibleIds.resize(numBoxes);
+
+    for (unsigned i = 0; i < numBoxes; ++i) {
+        const float dist = slack[i];
+        const float absDist = std::fabs(dist);
+        const unsigned char isVisible = dist >= 0.f ? 1 : 0;
+        const unsigned bucket = absDist <= maxSlack
+            ? std::min(NUM_SLACK_BUCKETS - 1u, (unsigned)(absDist * bucketScale))
+            : NUM_SLACK_BUCKETS;
+
+        refVisible[i] = isVisible;
+        refVisibleIds[numVisible] = i;
+        numVisible += isVisible;
+
+        slackBuckets[i] = (unsigned char)bucket;
+        ++bucketCounts[bucket];
+    }
+
+    refVisibleIds.resize(numVisible);
+
+    // bucketEnds holds each bucket's start until every box is placed
+    unsigned numNearBoxes = 0;
+    bucketEnds.resize(NUM_SLACK_BUCKETS);
+
+    for (unsigned b = 0; b < NUM_SLACK_BUCKETS; ++b) {
+        bucketEnds[b] = numNearBoxes;
+        numNearBoxes += bucketCounts[b];
+    }
+
+    retestOrder.resize(numNearBoxes);
+
+    for (unsigned i = 0; i < numBoxes; ++i) {
+        const unsigned bucket = slackBuckets[i];
+
+        if (bucket < NUM_SLACK_BUCKETS) {
+            retestOrder[bucketEnds[bucket]++] = i;
+        }
+    }
+
+    numTestsPerformed += numBoxes;
+    ++numFullUpdates;
+}
+
+/*-------------------------------------
+ * Temporal frustum culling
+-------------------------------------*/
+unsigned VisibilityCache::cull(
+    const FrustumPlanes& frustum,
+    const CullingBounds& bounds,
+    std::vector<unsigned>& outVisible,
+    WorkerPool* pWorkers
+) {
+    const unsigned numBoxes = bounds.size();
+
+    // Cached results refer to the old boxes
+    if (numBoxes != (unsigned)refVisible.size()) {
+        invalidate();
+    }
+
+    const float delta = hasReference ? get_frustum_delta(frustum) : 0.f;
+
+    if (!hasReference || delta > maxFrustumDelta * sceneRadius) {
+        full_update(frustum, bounds, pWorkers);
+        outVisible = refVisibleIds;
+        return (unsigned)outVisible.size();
+    }
+
+    // Boxes further than "delta" from every plane can't have changed. Every
+    // box in a bucket overlapping [0, delta] is re-tested.
+    const unsigned lastBucket = std::min(NUM_SLACK_BUCKETS - 1u, (unsigned)(delta * bucketScale));
+    const unsigned numRetests = bucketEnds.empty() ? 0u : bucketEnds[lastBucket];
+
+    // Scattered scalar tests are slower than streaming every box through the
+    // SIMD kernels.
+    if (numRetests > numBoxes / MAX_RETEST_RATIO) {
+        culler.cull(frustum, bounds, outVisible, pWorkers);
+        numTestsPerformed += numBoxes;
+        ++numLinearCulls;
+        return (unsigned)outVisible.size();
+    }
+
+    changedIds.clear();
+
+    for (unsigned k = 0; k < numRetests; ++k) {
+        const unsigned i = retestOrder[k];
+        float boxMin[3], boxMax[3];
+        bounds.get_bounds(i, boxMin, boxMax);
+
+        const unsigned char isVisible = is_box_visible(frustum, boxMin, boxMax) ? 1 : 0;
+
+        if (isVisible != refVisible[i]) {
+            changedIds.push_back(i);
+        }
+    }
+
+    numTestsPerformed += numRetests;
+    numTestsSkipped += numBoxes - numRetests;
+
+    // Changed boxes are either added to or removed from the reference set
+    std::sort(changedIds.begin(), changedIds.end());
+
+    outVisible.clear();
+    std::set_symmetric_difference(
+        refVisibleIds.begin(), refVisibleIds.end(),
+        changedIds.begin(), changedIds.end(),
+        std::back_inserter(outVisible)
+    );
+
+    return (unsigned)outVisible.size();
+}
+
+/*-------------------------------------
+ * Check if the last occlusion pass is still valid
+-------------------------------------*/
+bool VisibilityCache::can_reuse_occlusion(const FrustumPlanes& frustum) const noexcept {
+    if (!hasOcclusionResult || !hasReference) {
+        return false;
+    }
+
+    const float delta = get_plane_delta(frustum, occlusionFrustum, sceneRadius);
+    return delta <= maxOcclusionDelta * sceneRadius;
+}
+
+/*-------------------------------------
+ * Save an occlusion result
+-------------------------------------*/
+void VisibilityCache::store_occlusion(
+    const FrustumPlanes& frustum,
+    const std::vector<unsigned>& candidates,
+    const std::vector<unsigned>& visible
+) {
+    occlusionFrustum = frustum;
+    hasOcclusionResult = true;
+    ++numOcclusionPasses;
+
+    occludedBoxes.reset((unsigned)refVisible.size());
+
+    // Both lists are sorted, so anything missing from "visible" was occluded
+    std::vector<unsigned>::const_iterator v = visible.begin();
+
+    for (const unsigned c : candidates) {
+        while (v != visible.end() && *v < c) {
+            ++v;
+        }
+
+        if (v == visible.end() || *v != c) {
+            occludedBoxes.insert(c);
+        }
+    }
+}
+
+/*-------------------------------------
+ * Apply an occlusion result
+-------------------------------------*/
+unsigned VisibilityCache::remove_occluded(const std::vector<unsigned>& candidates, std::vector<unsigned>& outVisible) const {
+    const unsigned numCandidates = (unsigned)candidates.size();
+    unsigned numVisible = 0;
+
+    // Compaction works in-place if the candidates and output are the same
+    outVisible.resize(numCandidates);
+
+    for (unsigned i = 0; i < numCandidates; ++i) {
+        const unsigned c = candidates[i];
+        outVisible[numVisible] = c;
+        numVisible += occludedBoxes.contains(c) ? 0 : 1;
+    }
+
+    outVisible.resize(numVisible);
+
+    return numVisible;
+}
+
+/*-------------------------------------
+ * Reuse an occlusion result
+-------------------------------------*/
+unsigned VisibilityCache::reuse_occlusion(const std::vector<unsigned>& candidates, std::vector<unsigned>& outVisible) {
+    ++numOcclusionReuses;
+    return remove_occluded(candidates, outVisible);
+}
@@ -0,0 +1,293 @@
+/*
+ * File:   VisibilityCache.h
+ */
+
+#ifndef VISIBILITYCACHE_H
+#define VISIBILITYCACHE_H
+
+#include <vector>
+
+#include "FrustumCulling.h"
+#include "VisibilitySet.h"
+
+
+
+class WorkerPool;
+
+
+
+/**----------------------------------------------------------------------------
+ * Reuses visibility results between frames while the camera moves slowly.
+ *
+ * Frustum culling: every box is tested once against a reference frustum,
+ * recording how far inside or outside of the frustum it is (its "slack").
+ * On later frames, the largest distance any point in the scene could have
+ * moved relative to a frustum plane is calculated from the change in planes.
+ * Only boxes whose slack is smaller than that distance are tested again, so
+ * the results are identical to testing every box. A full update happens
+ * once the camera moves too far from the reference frustum, and a plain
+ * linear cull is used when too many boxes would need to be tested again.
+ *
+ * Occlusion culling: the set of occluded boxes is kept until the camera
+ * moves beyond a threshold. Boxes which enter the frustum while the result
+ * is being reused are treated as visible. The threshold bounds how stale the
+ * occlusion results can become.
+-----------------------------------------------------------------------------*/
+class VisibilityCache {
+  public:
+    /**
+     * @brief Number of slack ranges used to order boxes for re-testing.
+     */
+    static constexpr unsigned NUM_SLACK_BUCKETS = 64;
+
+    /**
+     * @brief Partial updates which would re-test more than 1/N of all boxes
+     * use a linear SIMD cull instead.
+     */
+    static constexpr unsigned MAX_RETEST_RATIO = 8;
+
+  private:
+    bool hasReference;
+
+    bool hasOcclusionResult;
+
+    float sceneRadius;
+
+    float maxFrustumDelta;
+
+    float maxOcclusionDelta;
+
+    // Converts a box's slack into its bucket index
+    float bucketScale;
+
+    FrustumPlanes refFrustum;
+
+    FrustumPlanes occlusionFrustum;
+
+    FrustumCuller culler;
+
+    // Signed distance of each box to the reference frustum
+    std::vector<float> slack;
+
+    // Slack bucket of each box, or NUM_SLACK_BUCKETS if it's never re-tested
+    std::vector<unsigned char> slackBuckets;
+
+    // Boxes close enough to the reference frustum to be re-tested, grouped by
+    // increasing slack
+    std::vector<unsigned> retestOrder;
+
+    // End of each bucket in retestOrder
+    std::vector<unsigned> bucketEnds;
+
+    std::vector<unsigned char> refVisible;
+
+    // Visible boxes from the reference frustum, in ascending order
+    std::vector<unsigned> refVisibleIds;
+
+    // Re-tested boxes whose visibility differs from the reference frustum
+    std::vector<unsigned> changedIds;
+
+    VisibilitySet occludedBoxes;
+
+    unsigned long long numTestsPerformed;
+
+    unsigned long long numTestsSkipped;
+
+    unsigned numFullUpdates;
+
+    unsigned numLinearCulls;
+
+    unsigned numOcclusionPasses;
+
+    unsigned numOcclusionReuses;
+
+    void full_update(const FrustumPlanes& frustum, const CullingBounds& bounds, WorkerPool* pWorkers);
+
+  public:
+    ~VisibilityCache() noexcept;
+
+    /**
+     * @brief Constructor
+     *
+     * @param maxFrustumChange
+     * Camera movement allowed before every box is tested again, as a fraction
+     * of the scene's radius.
+     *
+     * @param maxOcclusionChange
+     * Camera movement allowed before occlusion results must be recalculated,
+     * as a fraction of the scene's radius.
+     */
+    VisibilityCache(const float maxFrustumChange = 0.05f, const float maxOcclusionChange = 0.005f) noexcept;
+
+    VisibilityCache(const VisibilityCache&) = default;
+
+    VisibilityCache(VisibilityCache&&) noexcept;
+
+    VisibilityCache& operator=(const VisibilityCache&) = default;
+
+    VisibilityCache& operator=(VisibilityCache&&) noexcept;
+
+    /**
+     * @brief Discard all cached results. This must be called whenever the
+     * bounding boxes change.
+     */
+    void invalidate() noexcept;
+
+    /**
+     * @brief Free all memory and reset all statistics.
+     */
+    void clear() noexcept;
+
+    /**
+     * @brief Determine the furthest distance any point in the scene could
+     * have moved, relative to the frustum planes used for the last full
+     * update.
+     */
+    float get_frustum_delta(const FrustumPlanes& frustum) const noexcept;
+
+    /**
+     * @brief Find all boxes which intersect a frustum, testing only boxes
+     * whose visibility could have changed.
+     *
+     * @param outVisible
+     * Replaced with the index of every visible box, in ascending order.
+     *
+     * @param pWorkers
+     * If not NULL, full updates and linear culls are split across these
+     * threads.
+     *
+     * @return The number of visible boxes.
+     */
+    unsigned cull(
+        const FrustumPlanes& frustum,
+        const CullingBounds& bounds,
+        std::vector<unsigned>& outVisible,
+        WorkerPool* pWorkers = nullptr
+    );
+
+    /**
+     * @brief Determine if the last occlusion result is close enough to a
+     * frustum to be reused.
+     */
+    bool can_reuse_occlusion(const FrustumPlanes& frustum) const noexcept;
+
+    /**
+     * @brief Save the result of an occlusion pass.
+     *
+     * @param frustum
+     * The frustum the occlusion pass was rendered with.
+     *
+     * @param candidates
+     * The boxes which were tested for occlusion, in ascending order.
+     *
+     * @param visible
+     * The boxes which were not occluded, in ascending order.
+     */
+    void store_occlusion(
+        const FrustumPlanes& frustum,
+        const std::vector<unsigned>& candidates,
+        const std::vector<unsigned>& visible
+    );
+
+    /**
+     * @brief Remove boxes occluded in the last occlusion pass from a set of
+     * candidates.
+     *
+     * @param candidates
+     * The boxes in the current frustum. This may be the same object as
+     * "outVisible".
+     *
+     * @param outVisible
+     * Replaced with all candidates which were not occluded in the last
+     * occlusion pass, in the same order as the input.
+     *
+     * @return The number of visible boxes.
+     */
+    unsigned remove_occluded(const std::vector<unsigned>& candidates, std::vector<unsigned>& outVisible) const;
+
+    /**
+     * @brief Reuse the last occlusion pass in place of a new one.
+     *
+     * This is remove_occluded(), counted as a reused result.
+     */
+    unsigned reuse_occlusion(const std::vector<unsigned>& candidates, std::vector<unsigned>& outVisible);
+
+    /**
+     * @brief Reset all statistics.
+     */
+    void reset_counters() noexcept;
+
+    /**
+     * @brief Retrieve the number of box/frustum tests performed, including
+     * full updates and linear culls.
+     */
+    unsigned long long get_num_tests_performed() const noexcept;
+
+    /**
+     * @brief Retrieve the number of box/frustum tests skipped because the
+     * result could not have changed.
+     */
+    unsigned long long get_num_tests_skipped() const noexcept;
+
+    /**
+     * @brief Retrieve the number of times every box was tested to build a new
+     * reference frustum.
+     */
+    unsigned get_num_full_updates() const noexcept;
+
+    /**
+     * @brief Retrieve the number of times a linear cull replaced a partial
+     * update with too many boxes to re-test.
+     */
+    unsigned get_num_linear_culls() const noexcept;
+
+    /**
+     * @brief Retrieve the number of occlusion results saved.
+     */
+    unsigned get_num_occlusion_passes() const noexcept;
+
+    /**
+     * @brief Retrieve the number of times an occlusion result was reused.
+     */
+    unsigned get_num_occlusion_reuses() const noexcept;
+};
+
+
+
+inline unsigned long long VisibilityCache::get_num_tests_performed() const noexcept {
+    return numTestsPerformed;
+}
+
+
+
+inline unsigned long long VisibilityCache::get_num_tests_skipped() const noexcept {
+    return numTestsSkipped;
+}
+
+
+
+inline unsigned VisibilityCache::get_num_full_updates() const noexcept {
+    return numFullUpdates;
+}
+
+
+
+inline unsigned VisibilityCache::get_num_linear_culls() const noexcept {
+    return numLinearCulls;
+}
+
+
+
+inline unsigned VisibilityCache::get_num_occlusion_passes() const noexcept {
+    return numOcclusionPasses;
+}
+
+
+
+inline unsigned VisibilityCache::get_num_occlusion_reuses() const noexcept {
+    return numOcclusionReuses;
+}
+
+
+
+#endif  /* VISIBILITYCACHE_H */
@@ -0,0 +1,171 @@
+/*
+ * File:   VisibilitySet.cpp
+ */
+
+#include <algorithm> // std::fill
+#include <utility> // std::move
+
+#include "VisibilitySet.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define LS_TEST_VISIBILITY_SSE 1
+#else
+    #define LS_TEST_VISIBILITY_SSE 0
+#endif
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+
+
+/*-----------------------------------------------------------------------------
+ * Private helpers
+-----------------------------------------------------------------------------*/
+namespace {
+
+/*-------------------------------------
+ * Index of the lowest set bit in a non-zero word
+-------------------------------------*/
+inline unsigned lowest_bit_index(const uint32_t word) noexcept {
+    #if defined(__GNUC__) || defined(__clang__)
+        return (unsigned)__builtin_ctz(word);
+    #elif defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, word);
+        return (unsigned)index;
+    #else
+        unsigned index = 0;
+        while (!(word & (1u << index))) {
+            ++index;
+        }
+        return index;
+    #endif
+}
+
+} // end anonymous namespace
+
+
+
+/*-----------------------------------------------------------------------------
+ * Visibility Set
+-----------------------------------------------------------------------------*/
+constexpr uint32_t VisibilitySet::EMPTY_PIXEL;
+constexpr uint32_t VisibilitySet::PIXEL_ID_MASK;
+
+/*-------------------------------------
+ * Destructor
+-------------------------------------*/
+VisibilitySet::~VisibilitySet() noexcept {
+}
+
+/*-------------------------------------
+ * Constructor
+-------------------------------------*/
+VisibilitySet::VisibilitySet() noexcept :
+    numIds{0},
+    bits{}
+{}
+
+/*-------------------------------------
+ * Move Constructor
+-------------------------------------*/
+VisibilitySet::VisibilitySet(VisibilitySet&& vs) noexcept :
+    numIds{vs.numIds},
+    bits{std::move(vs.bits)}
+{
+    vs.numIds = 0;
+}
+
+/*-------------------------------------
+ * Move Operator
+-------------------------------------*/
+VisibilitySet& VisibilitySet::operator=(VisibilitySet&& vs) noexcept {
+    numIds = vs.numIds;
+    vs.numIds = 0;
+
+    bits = std::move(vs.bits);
+
+    return *this;
+}
+
+/*-------------------------------------
+ * Clear and resize
+-------------------------------------*/
+void VisibilitySet::reset(const unsigned maxIds) {
+    numIds = maxIds;
+    bits.resize((maxIds + 31u) / 32u);
+    std::fill(bits.begin(), bits.end(), 0u);
+}
+
+/*-------------------------------------
+ * Scan an ID buffer
+-------------------------------------*/
+void VisibilitySet::insert_id_buffer(const uint32_t* pPixels, const unsigned numPixels) noexcept {
+    unsigned i = 0;
+
+    // Neighboring pixels usually belong to the same object
+    uint32_t prevPixel = EMPTY_PIXEL;
+
+    #if LS_TEST_VISIBILITY_SSE
+        for (; i + 16 <= numPixels; i += 16) {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pPixels + i));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pPixels + i + 4));
+            const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pPixels + i + 8));
+            const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pPixels + i + 12));
+
+            // Blocks of a single ID, including empty blocks, need one check
+            const uint32_t first = pPixels[i];
+            const __m128i firstPixel = _mm_set1_epi32((int)first);
+            const __m128i same = _mm_and_si128(
+                _mm_and_si128(_mm_cmpeq_epi32(a, firstPixel), _mm_cmpeq_epi32(b, firstPixel)),
+                _mm_and_si128(_mm_cmpeq_epi32(c, firstPixel), _mm_cmpeq_epi32(d, firstPixel))
+            );
+
+            if (_mm_movemask_epi8(same) == 0xFFFF) {
+                if (first != EMPTY_PIXEL && first != prevPixel) {
+                    insert(first & PIXEL_ID_MASK);
+                    prevPixel = first;
+                }
+                continue;
+            }
+
+            for (unsigned j = i; j < i + 16; ++j) {
+                const uint32_t px = pPixels[j];
+
+                if (px != EMPTY_PIXEL && px != prevPixel) {
+                    insert(px & PIXEL_ID_MASK);
+                    prevPixel = px;
+                }
+            }
+        }
+    #endif
+
+    for (; i < numPixels; ++i) {
+        const uint32_t px = pPixels[i];
+
+        if (px != EMPTY_PIXEL && px != prevPixel) {
+            insert(px & PIXEL_ID_MASK);
+            prevPixel = px;
+        }
+    }
+}
+
+/*-------------------------------------
+ * Sorted list of IDs
+-------------------------------------*/
+unsigned VisibilitySet::get_ids(std::vector<unsigned>& outIds) const {
+    outIds.clear();
+
+    for (unsigned w = 0; w < (unsigned)bits.size(); ++w) {
+        uint32_t word = bits[w];
+
+        while (word) {
+            outIds.push_back((w << 5u) + lowest_bit_index(word));
+            word &= word - 1u;
+        }
+    }
+
+    return (unsigned)outIds.size();
+}
@@ -0,0 +1,124 @@
+/*
+ * File:   VisibilitySet.h
+ */
+
+#ifndef VISIBILITYSET_H
+#define VISIBILITYSET_H
+
+#include <cstdint>
+#include <vector>
+
+
+
+/**----------------------------------------------------------------------------
+ * A set of visible object IDs, stored as one bit per object.
+ *
+ * This is used to collapse the per-pixel results of an occlusion query (such
+ * as an ID buffer read back from the GPU) into a list containing each visible
+ * object exactly once.
+-----------------------------------------------------------------------------*/
+class VisibilitySet {
+  private:
+    unsigned numIds;
+
+    std::vector<uint32_t> bits;
+
+  public:
+    /**
+     * @brief Pixel value which marks an empty area of an ID buffer (opaque
+     * white, matching the occlusion FBO's clear color).
+     */
+    static constexpr uint32_t EMPTY_PIXEL = 0xFFFFFFFFu;
+
+    /**
+     * @brief Mask of the bits in an RGBA8 pixel which hold an object ID.
+     */
+    static constexpr uint32_t PIXEL_ID_MASK = 0x00FFFFFFu;
+
+    ~VisibilitySet() noexcept;
+
+    VisibilitySet() noexcept;
+
+    VisibilitySet(const VisibilitySet&) = default;
+
+    VisibilitySet(VisibilitySet&&) noexcept;
+
+    VisibilitySet& operator=(const VisibilitySet&) = default;
+
+    VisibilitySet& operator=(VisibilitySet&&) noexcept;
+
+    /**
+     * @brief Remove all IDs and resize the set.
+     *
+     * @param maxIds
+     * IDs in the range [0, maxIds) can be added to the set. Memory is only
+     * reallocated if the set grows.
+     */
+    void reset(const unsigned maxIds);
+
+    /**
+     * @brief Retrieve the number of IDs which can be stored.
+     */
+    unsigned get_max_ids() const noexcept;
+
+    /**
+     * @brief Add an ID to the set. IDs outside of the range given to reset()
+     * are ignored.
+     */
+    void insert(const unsigned id) noexcept;
+
+    /**
+     * @brief Determine if an ID is in the set.
+     */
+    bool contains(const unsigned id) const noexcept;
+
+    /**
+     * @brief Add every ID found in a buffer of RGBA8 pixels.
+     *
+     * IDs are stored in the red, green, and blue channels (red is the least
+     * significant byte). Pixels equal to EMPTY_PIXEL are skipped. Empty areas
+     * and runs of one ID are skipped 16 pixels at a time using SIMD where
+     * available.
+     *
+     * @param pPixels
+     * Pixels which were read as 32-bit words on a little-endian CPU.
+     *
+     * @param numPixels
+     * The number of pixels in the buffer.
+     */
+    void insert_id_buffer(const uint32_t* pPixels, const unsigned numPixels) noexcept;
+
+    /**
+     * @brief Retrieve all IDs in the set.
+     *
+     * @param outIds
+     * Replaced with each ID in the set, in ascending order.
+     *
+     * @return The number of IDs in the set.
+     */
+    unsigned get_ids(std::vector<unsigned>& outIds) const;
+};
+
+
+
+inline unsigned VisibilitySet::get_max_ids() const noexcept {
+    return numIds;
+}
+
+
+
+inline void VisibilitySet::insert(const unsigned id) noexcept {
+    if (id < numIds) {
+        bits[id >> 5u] |= 1u << (id & 31u);
+    }
+}
+
+
+
+inline bool VisibilitySet::contains(const unsigned id) const noexcept {
+    return id < numIds && (bits[id >> 5u] & (1u << (id & 31u))) != 0;
+}
+
+
+
+#endif  /* VISIBILITYSET_H */
@@ -0,0 +1,150 @@
+/*
+ * File:   WorkerPool.cpp
+ */
+
+#include "WorkerPool.h"
+
+
+
+/*-----------------------------------------------------------------------------
+ * Worker Pool
+-----------------------------------------------------------------------------*/
+/*-------------------------------------
+ * Destructor
+-------------------------------------*/
+WorkerPool::~WorkerPool() noexcept {
+    {
+        std::lock_guard<std::mutex> lock{poolMutex};
+        isRunning = false;
+    }
+
+    wakeCondition.notify_all();
+
+    for (std::thread& t : threads) {
+        t.join();
+    }
+}
+
+/*-------------------------------------
+ * Constructor
+-------------------------------------*/
+WorkerPool::WorkerPool(unsigned numThreads) :
+    poolMutex{},
+    wakeCondition{},
+    doneCondition{},
+    threads{},
+    pTaskFunc{nullptr},
+    numTasks{0},
+    nextTask{0},
+    numTasksDone{0},
+    numActiveThreads{0},
+    generation{0},
+    isRunning{true}
+{
+    if (!numThreads) {
+        const unsigned numCores = std::thread::hardware_concurrency();
+        numThreads = numCores > 1 ? numCores - 1 : 0;
+    }
+
+    threads.reserve(numThreads);
+
+    for (unsigned i = 0; i < numThreads; ++i) {
+        threads.emplace_back(&WorkerPool::thread_loop, this);
+    }
+}
+
+/*-------------------------------------
+ * Grab tasks until none remain
+-------------------------------------*/
+unsigned WorkerPool::execute_tasks(const std::function<void(unsigned)>* pFunc, const unsigned taskCount) noexcept {
+    unsigned tasksRun = 0;
+
+    for (unsigned task = nextTask.fetch_add(1); task < taskCount; task = nextTask.fetch_add(1)) {
+        (*pFunc)(task);
+        ++tasksRun;
+    }
+
+    return tasksRun;
+}
+
+/*-------------------------------------
+ * Thread main loop
+-------------------------------------*/
+void WorkerPool::thread_loop() noexcept {
+    unsigned lastGeneration = 0;
+
+    while (true) {
+        const std::function<void(unsigned)>* pFunc;
+        unsigned taskCount;
+
+        {
+            std::unique_lock<std::mutex> lock{poolMutex};
+            wakeCondition.wait(lock, [&]()->bool {
+                return !isRunning || generation != lastGeneration;
+            });
+
+            if (!isRunning) {
+                return;
+            }
+
+            lastGeneration = generation;
+            pFunc = pTaskFunc;
+            taskCount = numTasks;
+            ++numActiveThreads;
+        }
+
+        // Threads which wake after run() returns find no remaining tasks and
+        // never dereference the (possibly stale) task function.
+        const unsigned tasksRun = execute_tasks(pFunc, taskCount);
+
+        {
+            std::lock_guard<std::mutex> lock{poolMutex};
+            numTasksDone += tasksRun;
+            --numActiveThreads;
+        }
+
+        doneCondition.notify_all();
+    }
+}
+
+/*-------------------------------------
+ * Execute tasks and wait
+-------------------------------------*/
+void WorkerPool::run(const unsigned taskCount, const std::function<void(unsigned)>& taskFunc) noexcept {
+    if (!taskCount) {
+        return;
+    }
+
+    if (threads.empty() || taskCount == 1) {
+        for (unsigned i = 0; i < taskCount; ++i) {
+            taskFunc(i);
+        }
+        return;
+    }
+
+    {
+        // Threads from a previous call must finish before task counters are
+        // reset.
+        std::unique_lock<std::mutex> lock{poolMutex};
+        doneCondition.wait(lock, [&]()->bool {
+            return numActiveThreads == 0;
+        });
+
+        pTaskFunc = &taskFunc;
+        numTasks = taskCount;
+        numTasksDone = 0;
+        nextTask.store(0);
+        ++generation;
+    }
+
+    wakeCondition.notify_all();
+
+    const unsigned tasksRun = execute_tasks(&taskFunc, taskCount);
+
+    std::unique_lock<std::mutex> lock{poolMutex};
+    numTasksDone += tasksRun;
+
+    doneCondition.wait(lock, [&]()->bool {
+        return numTasksDone == numTasks && numActiveThreads == 0;
+    });
+}
@@ -0,0 +1,99 @@
+/*
+ * File:   WorkerPool.h
+ */
+
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+
+/**----------------------------------------------------------------------------
+ * Persistent threads for splitting per-frame work into independent tasks.
+ *
+ * The thread calling run() also executes tasks, so a pool created with N
+ * threads runs tasks on N+1 threads. Threads sleep between calls to run().
+-----------------------------------------------------------------------------*/
+class WorkerPool {
+  private:
+    std::mutex poolMutex;
+
+    std::condition_variable wakeCondition;
+
+    std::condition_variable doneCondition;
+
+    std::vector<std::thread> threads;
+
+    const std::function<void(unsigned)>* pTaskFunc;
+
+    unsigned numTasks;
+
+    std::atomic_uint nextTask;
+
+    unsigned numTasksDone;
+
+    unsigned numActiveThreads;
+
+    unsigned generation;
+
+    bool isRunning;
+
+    void thread_loop() noexcept;
+
+    unsigned execute_tasks(const std::function<void(unsigned)>* pFunc, const unsigned taskCount) noexcept;
+
+  public:
+    ~WorkerPool() noexcept;
+
+    /**
+     * @brief Constructor
+     *
+     * @param numThreads
+     * The number of threads to spawn in addition to the calling thread. A
+     * value of 0 uses one thread less than the number of CPU cores.
+     */
+    explicit WorkerPool(unsigned numThreads = 0);
+
+    WorkerPool(const WorkerPool&) = delete;
+
+    WorkerPool(WorkerPool&&) = delete;
+
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    WorkerPool& operator=(WorkerPool&&) = delete;
+
+    /**
+     * @brief Retrieve the number of threads which execute tasks, including
+     * the thread calling run().
+     */
+    unsigned get_concurrency() const noexcept;
+
+    /**
+     * @brief Execute a function once per task and wait for all tasks to
+     * finish.
+     *
+     * @param taskCount
+     * The number of tasks to run. Each task ID in the range [0, taskCount)
+     * is passed to taskFunc exactly once.
+     *
+     * @param taskFunc
+     * A function which must be safe to call from multiple threads at once.
+     */
+    void run(const unsigned taskCount, const std::function<void(unsigned)>& taskFunc) noexcept;
+};
+
+
+
+inline unsigned WorkerPool::get_concurrency() const noexcept {
+    return (unsigned)threads.size() + 1u;
+}
+
+
+
+#endif  /* WORKERPOOL_H */
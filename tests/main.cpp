@@ -3,7 +3,10 @@
 #include <iostream>
 #include <SDL2/SDL.h>
 
+#include "lightsky/utils/Log.h"
+
 #include "ControlState.h"
+#include "CpuFeatures.h"
 #include "MainState.h"
 
 namespace math = ls::math;
@@ -20,6 +23,8 @@ extern "C" int main(int argc, char* argv[]) {
         std::cout << "Argument " << i << ": " << argv[i] << '\n';
     }
 
+    LS_LOG_MSG("CPU Features: ", get_cpu_feature_names());
+
     if (!sys.start()
     || !sys.push_game_state(new(std::nothrow) MainState{})
     || !sys.push_game_state(new(std::nothrow) ControlState{})